@@ -3,7 +3,25 @@
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/iosched.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/thread.h"
+
+/* Most sectors in one merged driver call. */
+#define MERGE_MAX 64
+
+/* Queue of requests for a block device. */
+struct block_queue
+  {
+    struct lock lock;                   /* Protects the members below. */
+    struct condition not_empty;         /* Signaled when a request arrives. */
+    struct list requests;               /* Pending requests, in arrival order. */
+    const struct iosched *sched;        /* Chooses among REQUESTS. */
+    struct iosched_head head;           /* Position after the last dispatch. */
+    uint8_t *merge_buffer;              /* MERGE_MAX sectors for merged calls. */
+  };
 
 /* A block device. */
 struct block
@@ -19,6 +37,10 @@ struct block
 
     unsigned long long read_cnt;        /* Number of sectors read. */
     unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stats stats;           /* Updated with interrupts off. */
+    block_sector_t next_sector;         /* Sector after the last request. */
+
+    struct block_queue *queue;          /* Request queue, or null. */
   };
 
 /* List of all block devices. */
@@ -27,7 +49,11 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 /* The block block assigned to each Pintos role. */
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
+/* I/O scheduler for devices registered from now on. */
+static const struct iosched *default_sched = &iosched_deadline;
+
 static struct block *list_elem_to_block (struct list_elem *);
+static void queue_create (struct block *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -120,9 +146,7 @@ check_sector (struct block *block, block_sector_t sector)
 void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
-  check_sector (block, sector);
-  block->ops->read (block->aux, sector, buffer);
-  block->read_cnt++;
+  block_read_multiple (block, sector, 1, buffer);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -133,10 +157,42 @@ block_read (struct block *block, block_sector_t sector, void *buffer)
 void
 block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
-  check_sector (block, sector);
-  ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  block_write_multiple (block, sector, 1, buffer);
+}
+
+/* Reads CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it do this with a single
+   command; for others it is the same as CNT calls to
+   block_read(). */
+void
+block_read_multiple (struct block *block, block_sector_t sector,
+                     size_t cnt, void *buffer)
+{
+  struct block_request req;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&req, false, sector, cnt, buffer, NULL, NULL);
+  block_submit (block, &req);
+  block_wait (&req);
+}
+
+/* Writes CNT consecutive sectors starting at SECTOR to BLOCK from
+   BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving all
+   of the data.  See block_read_multiple(). */
+void
+block_write_multiple (struct block *block, block_sector_t sector,
+                      size_t cnt, const void *buffer)
+{
+  struct block_request req;
+
+  if (cnt == 0)
+    return;
+  block_request_init (&req, true, sector, cnt, (void *) buffer, NULL, NULL);
+  block_submit (block, &req);
+  block_wait (&req);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -160,10 +216,27 @@ block_type (struct block *block)
   return block->type;
 }
 
-/* Prints statistics for each block device used for a Pintos role. */
+/* Prints the nonzero buckets of latency histogram HIST, labeled
+   NAME. */
+static void
+print_histogram (const char *name, const uint32_t hist[BLOCK_STATS_BUCKETS])
+{
+  int i;
+
+  printf ("  %s (log2 cycles):", name);
+  for (i = 0; i < BLOCK_STATS_BUCKETS; i++)
+    if (hist[i] != 0)
+      printf (" %d:%"PRIu32, i, hist[i]);
+  printf ("\n");
+}
+
+/* Prints statistics for each block device used for a Pintos
+   role, followed by detailed statistics for each block device
+   that saw any requests. */
 void
 block_print_stats (void)
 {
+  struct list_elem *e;
   int i;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
@@ -176,6 +249,36 @@ block_print_stats (void)
                   block->read_cnt, block->write_cnt);
         }
     }
+
+  for (e = list_begin (&all_blocks); e != list_end (&all_blocks);
+       e = list_next (e))
+    {
+      struct block *block = list_entry (e, struct block, list_elem);
+      struct block_stats stats;
+
+      block_get_stats (block, &stats);
+      if (stats.requests == 0)
+        continue;
+      printf ("%s: %"PRIu32" requests, %"PRIu32"%% sequential, "
+              "%"PRIu64" bytes read, %"PRIu64" bytes written, "
+              "peak %"PRIu32" outstanding\n",
+              block->name, stats.requests,
+              (uint32_t) ((uint64_t) stats.sequential * 100 / stats.requests),
+              stats.read_bytes, stats.write_bytes, stats.peak_outstanding);
+      print_histogram ("wait", stats.wait);
+      print_histogram ("service", stats.service);
+    }
+}
+
+/* Copies BLOCK's statistics into *STATS.  For a partition, they
+   cover requests made through the partition; for a disk, all
+   requests. */
+void
+block_get_stats (struct block *block, struct block_stats *stats)
+{
+  enum intr_level old_level = intr_disable ();
+  *stats = block->stats;
+  intr_set_level (old_level);
 }
 
 /* Registers a new block device with the given NAME.  If
@@ -200,6 +303,11 @@ block_register (const char *name, enum block_type type,
   block->aux = aux;
   block->read_cnt = 0;
   block->write_cnt = 0;
+  memset (&block->stats, 0, sizeof block->stats);
+  block->next_sector = 0;
+  block->queue = NULL;
+  if (ops->remap == NULL && ops->submit == NULL)
+    queue_create (block);
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
@@ -221,3 +329,363 @@ list_elem_to_block (struct list_elem *list_elem)
           : NULL);
 }
 
+
+/* Log base 2 of CYCLES, as a histogram bucket. */
+static int
+bucket (uint64_t cycles)
+{
+  int b = 0;
+  while (cycles > 1 && b < BLOCK_STATS_BUCKETS - 1)
+    {
+      cycles >>= 1;
+      b++;
+    }
+  return b;
+}
+
+/* Accounts for REQ, whose sector is relative to BLOCK, being
+   submitted to BLOCK. */
+static void
+stats_submit (struct block *block, const struct block_request *req)
+{
+  struct block_stats *stats = &block->stats;
+  enum intr_level old_level = intr_disable ();
+
+  if (req->sector == block->next_sector)
+    stats->sequential++;
+  block->next_sector = req->sector + req->cnt;
+  if (++stats->outstanding > stats->peak_outstanding)
+    stats->peak_outstanding = stats->outstanding;
+  intr_set_level (old_level);
+}
+
+/* Accounts for REQ completing on BLOCK after waiting WAIT cycles
+   in the queue and SERVICE cycles in the driver. */
+static void
+stats_complete (struct block *block, const struct block_request *req,
+                uint64_t wait, uint64_t service)
+{
+  struct block_stats *stats = &block->stats;
+  enum intr_level old_level = intr_disable ();
+
+  if (req->write)
+    stats->write_bytes += (uint64_t) req->cnt * BLOCK_SECTOR_SIZE;
+  else
+    stats->read_bytes += (uint64_t) req->cnt * BLOCK_SECTOR_SIZE;
+  stats->requests++;
+  stats->outstanding--;
+  stats->wait[bucket (wait)]++;
+  stats->service[bucket (service)]++;
+  intr_set_level (old_level);
+}
+
+/* Marks REQ completed and notifies its owner. */
+static void
+finish (struct block_request *req)
+{
+  req->finished = true;
+  if (req->complete != NULL)
+    req->complete (req);
+  else
+    sema_up (&req->done);
+}
+
+/* Completes REQ, which was passed to the submit operation of the
+   device it was submitted to.  Its whole lifetime counts as
+   service time. */
+void
+block_complete (struct block_request *req)
+{
+  stats_complete (req->origin, req, 0,
+                  timer_cycles () - req->submitted_cycles);
+  finish (req);
+}
+
+/* Initializes REQ to read (or, if WRITE is true, write) CNT
+   sectors starting at SECTOR into (or from) BUFFER.  If
+   COMPLETE is non-null, the dispatcher calls it, passing REQ,
+   when the request completes; it may use AUX as it likes.
+   Otherwise wait for REQ with block_wait(). */
+void
+block_request_init (struct block_request *req, bool write,
+                    block_sector_t sector, size_t cnt, void *buffer,
+                    block_request_func *complete, void *aux)
+{
+  ASSERT (cnt > 0);
+
+  req->write = write;
+  req->sector = sector;
+  req->cnt = cnt;
+  req->buffer = buffer;
+  req->complete = complete;
+  req->aux = aux;
+  req->finished = false;
+  sema_init (&req->done, 0);
+}
+
+/* Queues REQ for BLOCK and returns without waiting for it.  REQ
+   and its buffer must stay valid until it completes. */
+void
+block_submit (struct block *block, struct block_request *req)
+{
+  struct block_queue *queue;
+
+  check_sector (block, req->sector);
+  check_sector (block, req->sector + req->cnt - 1);
+  ASSERT (!req->write || block->type != BLOCK_FOREIGN);
+
+  req->origin = block;
+  req->submitted = timer_ticks ();
+  req->submitted_cycles = timer_cycles ();
+  for (;;)
+    {
+      /* A disk's counts include its partitions' traffic, as when
+         partitions called into the disk. */
+      if (req->write)
+        block->write_cnt += req->cnt;
+      else
+        block->read_cnt += req->cnt;
+      stats_submit (block, req);
+      if (block->ops->remap == NULL)
+        break;
+      block = block->ops->remap (block->aux, &req->sector);
+    }
+
+  if (block->ops->submit != NULL)
+    {
+      ASSERT (block == req->origin);
+      block->ops->submit (block->aux, req);
+      return;
+    }
+
+  queue = block->queue;
+  lock_acquire (&queue->lock);
+  list_push_back (&queue->requests, &req->elem);
+  cond_signal (&queue->not_empty, &queue->lock);
+  lock_release (&queue->lock);
+}
+
+/* Waits for REQ, which must not have a completion callback, to
+   complete.  Any number of threads may wait for the same
+   request, any number of times. */
+void
+block_wait (struct block_request *req)
+{
+  ASSERT (req->complete == NULL);
+
+  sema_down (&req->done);
+  sema_up (&req->done);
+}
+
+/* Returns true if REQ, which must not have a completion
+   callback, has completed. */
+bool
+block_done (const struct block_request *req)
+{
+  ASSERT (req->complete == NULL);
+
+  return req->finished;
+}
+
+/* Makes the scheduler called NAME the I/O scheduler for block
+   devices registered from now on.  Returns false if there is no
+   such scheduler. */
+bool
+block_set_scheduler (const char *name)
+{
+  const struct iosched *sched = iosched_find (name);
+  if (sched == NULL)
+    return false;
+  default_sched = sched;
+  return true;
+}
+
+/* Calls BLOCK's driver to transfer CNT sectors starting at
+   SECTOR to or from BUFFER. */
+static void
+driver_transfer (struct block *block, bool write, block_sector_t sector,
+                 size_t cnt, uint8_t *buffer)
+{
+  const struct block_operations *ops = block->ops;
+  size_t i;
+
+  if (write && ops->write_multiple != NULL)
+    ops->write_multiple (block->aux, sector, cnt, buffer);
+  else if (!write && ops->read_multiple != NULL)
+    ops->read_multiple (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++, buffer += BLOCK_SECTOR_SIZE)
+      if (write)
+        ops->write (block->aux, sector + i, buffer);
+      else
+        ops->read (block->aux, sector + i, buffer);
+}
+
+/* Returns the first request queued in QUEUE before R that must
+   complete before R may start, because both touch a common
+   sector and one of them writes it, or a null pointer if there
+   is none. */
+static struct block_request *
+first_conflict (struct block_queue *queue, struct block_request *r)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&queue->requests); e != &r->elem; e = list_next (e))
+    {
+      struct block_request *q = list_entry (e, struct block_request, elem);
+      if ((q->write || r->write)
+          && q->sector < r->sector + r->cnt && r->sector < q->sector + q->cnt)
+        return q;
+    }
+  return NULL;
+}
+
+/* Moves every request in QUEUE's list that continues BATCH, a
+   list of requests for sectors FIRST through FIRST + *CNT - 1,
+   onto BATCH, as long as the batch stays within MERGE_MAX
+   sectors.  Updates *FIRST and *CNT. */
+static void
+merge (struct block_queue *queue, struct list *batch, bool write,
+       block_sector_t *first, size_t *cnt)
+{
+  bool merged;
+
+  do
+    {
+      struct list_elem *e;
+
+      merged = false;
+      for (e = list_begin (&queue->requests);
+           e != list_end (&queue->requests); e = list_next (e))
+        {
+          struct block_request *r = list_entry (e, struct block_request,
+                                                elem);
+          if (r->write != write || *cnt + r->cnt > MERGE_MAX
+              || first_conflict (queue, r) != NULL)
+            continue;
+          if (r->sector == *first + *cnt)
+            {
+              list_remove (e);
+              list_push_back (batch, e);
+            }
+          else if (r->sector + r->cnt == *first)
+            {
+              list_remove (e);
+              list_push_front (batch, e);
+              *first = r->sector;
+            }
+          else
+            continue;
+          *cnt += r->cnt;
+          merged = true;
+          break;
+        }
+    }
+  while (merged);
+}
+
+/* Dispatcher thread for BLOCK_: takes requests off the queue in
+   the order its scheduler picks, merges them with queued
+   requests for adjacent sectors, and hands them to the driver. */
+static void
+dispatch (void *block_)
+{
+  struct block *block = block_;
+  struct block_queue *queue = block->queue;
+
+  for (;;)
+    {
+      struct block_request *r;
+      struct list batch;
+      struct list_elem *e;
+      block_sector_t first;
+      size_t cnt;
+      uint8_t *p;
+      uint64_t start, end;
+
+      lock_acquire (&queue->lock);
+      while (list_empty (&queue->requests))
+        cond_wait (&queue->not_empty, &queue->lock);
+      r = queue->sched->select (&queue->requests, &queue->head);
+      for (;;)
+        {
+          struct block_request *conflict = first_conflict (queue, r);
+          if (conflict == NULL)
+            break;
+          r = conflict;
+        }
+      list_remove (&r->elem);
+      list_init (&batch);
+      list_push_back (&batch, &r->elem);
+      first = r->sector;
+      cnt = r->cnt;
+      merge (queue, &batch, r->write, &first, &cnt);
+      queue->head.sector = first + cnt;
+      lock_release (&queue->lock);
+
+      start = timer_cycles ();
+
+      if (list_front (&batch) == list_back (&batch))
+        driver_transfer (block, r->write, r->sector, r->cnt, r->buffer);
+      else
+        {
+          /* Merged: go through the merge buffer. */
+          if (r->write)
+            for (e = list_begin (&batch), p = queue->merge_buffer;
+                 e != list_end (&batch); e = list_next (e))
+              {
+                struct block_request *b = list_entry (e, struct block_request,
+                                                      elem);
+                memcpy (p, b->buffer, b->cnt * BLOCK_SECTOR_SIZE);
+                p += b->cnt * BLOCK_SECTOR_SIZE;
+              }
+          driver_transfer (block, r->write, first, cnt, queue->merge_buffer);
+          if (!r->write)
+            for (e = list_begin (&batch), p = queue->merge_buffer;
+                 e != list_end (&batch); e = list_next (e))
+              {
+                struct block_request *b = list_entry (e, struct block_request,
+                                                      elem);
+                memcpy (b->buffer, p, b->cnt * BLOCK_SECTOR_SIZE);
+                p += b->cnt * BLOCK_SECTOR_SIZE;
+              }
+        }
+
+      end = timer_cycles ();
+      while (!list_empty (&batch))
+        {
+          struct block_request *b = list_entry (list_pop_front (&batch),
+                                                struct block_request, elem);
+          stats_complete (block, b, start - b->submitted_cycles, end - start);
+          if (b->origin != block)
+            stats_complete (b->origin, b, start - b->submitted_cycles,
+                            end - start);
+          finish (b);
+        }
+    }
+}
+
+/* Gives BLOCK a request queue, using the default scheduler, and
+   starts its dispatcher thread. */
+static void
+queue_create (struct block *block)
+{
+  struct block_queue *queue = malloc (sizeof *queue);
+  char name[sizeof block->name + 3];    /* Room for "-io". */
+
+  if (queue != NULL)
+    queue->merge_buffer = malloc (MERGE_MAX * BLOCK_SECTOR_SIZE);
+  if (queue == NULL || queue->merge_buffer == NULL)
+    PANIC ("Failed to allocate memory for block device queue");
+
+  lock_init (&queue->lock);
+  cond_init (&queue->not_empty);
+  list_init (&queue->requests);
+  queue->sched = default_sched;
+  queue->head.sector = 0;
+  queue->head.down = false;
+  block->queue = queue;
+
+  snprintf (name, sizeof name, "%s-io", block->name);
+  thread_create (name, PRI_MAX, dispatch, block);
+}
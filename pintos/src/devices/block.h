@@ -3,6 +3,10 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <block-stats.h>
+#include <list.h>
+#include <stdbool.h>
+#include "threads/synch.h"
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,11 +57,63 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multiple (struct block *, block_sector_t, size_t cnt,
+                          void *);
+void block_write_multiple (struct block *, block_sector_t, size_t cnt,
+                           const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
 /* Statistics. */
 void block_print_stats (void);
+void block_get_stats (struct block *, struct block_stats *);
+
+/* Request queue.
+
+   Every device driven by a driver has a queue of pending
+   requests and a dispatcher thread that feeds them to the
+   driver, one at a time, in the order chosen by the device's I/O
+   scheduler (see devices/iosched.h).  Queued requests for
+   adjacent sectors are merged into a single driver call, and a
+   request never overtakes an earlier one for the same sectors
+   unless both are reads.
+
+   block_submit() queues a request and returns at once, so that
+   a thread may keep several requests in flight, on one device or
+   on several.  block_read() and friends submit a request and
+   wait for it. */
+struct block_request;
+
+/* Called when REQ completes, normally by a dispatcher thread.  The
+   request then belongs to the function, which may free it. */
+typedef void block_request_func (struct block_request *req);
+
+struct block_request
+  {
+    struct list_elem elem;              /* Element in the queue. */
+    bool write;                         /* Write (true) or read (false)? */
+    block_sector_t sector;              /* First sector on the queue's device. */
+    size_t cnt;                         /* Number of sectors. */
+    void *buffer;                       /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    int64_t submitted;                  /* Timer tick at submission. */
+    uint64_t submitted_cycles;          /* Time-stamp counter at submission. */
+    struct block *origin;               /* Device submitted to, before remapping. */
+
+    block_request_func *complete;       /* Completion callback, or null. */
+    void *aux;                          /* For COMPLETE. */
+    bool finished;                      /* Completed? */
+    struct semaphore done;              /* Up'd when the request completes. */
+  };
+
+void block_request_init (struct block_request *, bool write,
+                         block_sector_t, size_t cnt, void *buffer,
+                         block_request_func *, void *aux);
+void block_submit (struct block *, struct block_request *);
+void block_wait (struct block_request *);
+bool block_done (const struct block_request *);
+void block_complete (struct block_request *);
+
+bool block_set_scheduler (const char *name);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,6 +121,24 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Optional: transfer CNT consecutive sectors at once.  If
+       null, the block layer issues CNT single-sector calls. */
+    void (*read_multiple) (void *aux, block_sector_t, size_t cnt,
+                           void *buffer);
+    void (*write_multiple) (void *aux, block_sector_t, size_t cnt,
+                            const void *buffer);
+
+    /* Optional: for a device that is a window onto another one,
+       such as a partition, translates *SECTOR and returns the
+       underlying device.  Requests then join the underlying
+       device's queue and READ and WRITE are not used. */
+    struct block *(*remap) (void *aux, block_sector_t *sector);
+
+    /* Optional: takes requests directly instead of through a
+       queue, for a device that passes them on to other devices
+       itself.  It must call block_complete() for REQ when done. */
+    void (*submit) (void *aux, struct block_request *req);
   };
 
 struct block *block_register (const char *name, enum block_type,
@@ -3,15 +3,24 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/block.h"
 #include "devices/partition.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].
+
+   Data normally moves by PIO, through the CPU.  With the "-dma"
+   option, channels of a PCI bus-master IDE controller (such as
+   the PIIX emulated by QEMU and Bochs) use READ DMA and WRITE
+   DMA instead, and the CPU is free to run other threads while
+   sectors transfer. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -34,10 +43,25 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
 
+/* Bus-master IDE registers, relative to a channel's BM_BASE. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0)  /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)   /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)     /* PRD table. */
+
+/* Bus-master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start transfer. */
+#define BM_CMD_READ 0x08        /* Device to memory. */
+
+/* Bus-master Status Register bits.  ERROR and INTR are cleared
+   by writing 1. */
+#define BM_STA_ERROR 0x02       /* Transfer failed. */
+#define BM_STA_INTR 0x04        /* Device raised its interrupt. */
+
 /* Device Register bits. */
 #define DEV_MBS 0xa0            /* Must be set. */
 #define DEV_LBA 0x40            /* Linear based addressing. */
@@ -49,6 +73,16 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Most sectors transferred by one command.  The sector count
+   register is 8 bits wide, with 0 meaning 256; we stay below
+   that to keep things simple. */
+#define MAX_CMD_SECTORS 255
 
 /* An ATA device. */
 struct ata_disk
@@ -57,7 +91,23 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    int multiple;               /* Sectors per interrupt in READ/WRITE
+                                   MULTIPLE, or 1 if not supported. */
+    bool dma;                   /* Transfer by bus-master DMA? */
+  };
+
+/* Physical Region Descriptor: one physically contiguous piece
+   of a DMA transfer.  May not cross a 64 kB boundary. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address. */
+    uint16_t size;              /* Size in bytes, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
   };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Sectors in a channel's DMA bounce buffer. */
+#define BOUNCE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
 
 /* An ATA channel (aka controller).
    Each channel can control up to two disks. */
@@ -72,6 +122,10 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus-master base port, 0 if none. */
+    struct prd *prdt;           /* PRD table, one page from palloc. */
+    uint8_t *bounce;            /* DMA buffer for unaligned callers. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
@@ -81,14 +135,20 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+bool ide_dma;
+
+static uint16_t find_bus_master (void);
+static void init_dma (struct channel *, uint16_t bm_base);
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void set_multiple_mode (struct ata_disk *, int);
+static void select_sector (struct ata_disk *, block_sector_t, size_t);
 static void issue_pio_command (struct channel *, uint8_t command);
-static void input_sector (struct channel *, void *);
-static void output_sector (struct channel *, const void *);
+static void input_sector (struct channel *, void *, size_t);
+static void output_sector (struct channel *, const void *, size_t);
 
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
@@ -101,6 +161,7 @@ static void interrupt_handler (struct intr_frame *);
 void
 ide_init (void)
 {
+  uint16_t bm_base = ide_dma ? find_bus_master () : 0;
   size_t chan_no;
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
@@ -126,6 +187,9 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      c->bm_base = 0;
+      if (bm_base != 0)
+        init_dma (c, bm_base + chan_no * 8);
 
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +200,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->multiple = 1;
+          d->dma = false;
         }
 
       /* Register interrupt handler. */
@@ -155,6 +221,87 @@ ide_init (void)
     }
 }
 
+/* PCI configuration space ports. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+
+/* Reads 32-bit register REG of PCI function BUS:DEV.FUNC. */
+static uint32_t
+pci_read_config (int bus, int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDR,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to 32-bit register REG of PCI function
+   BUS:DEV.FUNC. */
+static void
+pci_write_config (int bus, int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDR,
+        0x80000000 | (bus << 16) | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks for a bus-master capable IDE controller on the PCI bus,
+   enables bus mastering on it and returns the base port of its
+   bus-master registers, or 0 if there is none. */
+static uint16_t
+find_bus_master (void)
+{
+  int bus, dev, func;
+
+  for (bus = 0; bus < 256; bus++)
+    for (dev = 0; dev < 32; dev++)
+      for (func = 0; func < 8; func++)
+        {
+          uint32_t id = pci_read_config (bus, dev, func, 0x00);
+          uint32_t class = pci_read_config (bus, dev, func, 0x08);
+          uint32_t bar4;
+
+          if ((id & 0xffff) == 0xffff)
+            {
+              if (func == 0)
+                break;
+              continue;
+            }
+
+          /* Class 01h (mass storage), subclass 01h (IDE), with
+             programming interface bit 7 (bus master). */
+          if ((class >> 16) != 0x0101 || (class & 0x8000) == 0)
+            continue;
+          bar4 = pci_read_config (bus, dev, func, 0x20);
+          if ((bar4 & 1) == 0 || (bar4 & 0xfffc) == 0)
+            continue;
+
+          /* Enable I/O space and bus mastering. */
+          pci_write_config (bus, dev, func, 0x04,
+                            pci_read_config (bus, dev, func, 0x04) | 0x05);
+          printf ("ide: bus-master DMA at port %#x (PCI %02x:%02x.%x)\n",
+                  (unsigned) (bar4 & 0xfffc), bus, dev, func);
+          return bar4 & 0xfffc;
+        }
+  printf ("ide: no bus-master IDE controller, using PIO\n");
+  return 0;
+}
+
+/* Sets up channel C for bus-master DMA through the registers at
+   BM_BASE.  Leaves C using PIO if memory is short. */
+static void
+init_dma (struct channel *c, uint16_t bm_base)
+{
+  c->prdt = palloc_get_page (0);
+  c->bounce = palloc_get_page (0);
+  if (c->prdt == NULL || c->bounce == NULL)
+    {
+      palloc_free_page (c->prdt);
+      palloc_free_page (c->bounce);
+      return;
+    }
+  c->bm_base = bm_base;
+}
+
 /* Disk detection and identification. */
 
 static char *descramble_ata_string (char *, int size);
@@ -279,7 +426,7 @@ identify_ata_device (struct ata_disk *d)
       d->is_ata = false;
       return;
     }
-  input_sector (c, id);
+  input_sector (c, id, 1);
 
   /* Calculate capacity.
      Read model name and serial number. */
@@ -303,6 +450,13 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Word 47 holds the largest number of sectors the disk can
+     transfer per interrupt in READ/WRITE MULTIPLE. */
+  set_multiple_mode (d, (uint8_t) id[47 * 2]);
+
+  /* Word 49 bit 8 says whether the disk can do DMA. */
+  d->dma = c->bm_base != 0 && (id[49 * 2 + 1] & 0x01) != 0;
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
@@ -337,63 +491,286 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Enables READ/WRITE MULTIPLE on disk D with blocks of up to
+   MAX sectors, leaving D->multiple at 1 if MAX is 1 or less or
+   the disk refuses. */
+static void
+set_multiple_mode (struct ata_disk *d, int max)
+{
+  struct channel *c = d->channel;
+
+  d->multiple = 1;
+  if (max <= 1)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), max);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_status (c)) & STA_ERR) == 0)
+    d->multiple = max;
+}
+
+/* Reads CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   from disk D into BUFFER by PIO.  Uses READ MULTIPLE if the
+   disk supports it, so that the disk interrupts once per
+   D->multiple sectors instead of once per sector. */
+static void
+pio_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+  size_t left;
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, d->multiple > 1 ? CMD_READ_MULTIPLE
+                                        : CMD_READ_SECTOR_RETRY);
+  for (left = cnt; left > 0; )
+    {
+      size_t block_cnt = (left < (size_t) d->multiple
+                          ? left : (size_t) d->multiple);
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name,
+               sec_no + (cnt - left));
+      input_sector (c, buffer, block_cnt);
+      buffer += block_cnt * BLOCK_SECTOR_SIZE;
+      left -= block_cnt;
+    }
+}
+
+/* Writes CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   to disk D from BUFFER by PIO.  Uses WRITE MULTIPLE if the disk
+   supports it. */
+static void
+pio_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+  size_t left;
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, d->multiple > 1 ? CMD_WRITE_MULTIPLE
+                                        : CMD_WRITE_SECTOR_RETRY);
+  for (left = cnt; left > 0; )
+    {
+      size_t block_cnt = (left < (size_t) d->multiple
+                          ? left : (size_t) d->multiple);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name,
+               sec_no + (cnt - left));
+      output_sector (c, buffer, block_cnt);
+      sema_down (&c->completion_wait);
+      buffer += block_cnt * BLOCK_SECTOR_SIZE;
+      left -= block_cnt;
+    }
+}
+
+/* Transfers CNT sectors, at most MAX_CMD_SECTORS, starting at
+   SEC_NO between disk D and BUFFER by bus-master DMA, writing to
+   the disk if WRITE is true.  BUFFER must be a word-aligned
+   kernel address, which is physically contiguous.  The calling
+   thread sleeps until the disk interrupts at the end.  Returns
+   false if the transfer failed. */
+static bool
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              const void *buffer, bool write)
+{
+  struct channel *c = d->channel;
+  uintptr_t addr = vtop (buffer);
+  size_t size = cnt * BLOCK_SECTOR_SIZE;
+  uint8_t direction = write ? 0 : BM_CMD_READ;
+  struct prd *prd = c->prdt;
+  uint8_t bm_status;
+
+  /* Describe BUFFER, split at 64 kB boundaries. */
+  while (size > 0)
+    {
+      size_t chunk = 0x10000 - (addr & 0xffff);
+      if (chunk > size)
+        chunk = size;
+      prd->addr = addr;
+      prd->size = chunk & 0xffff;
+      prd->flags = 0;
+      prd++;
+      addr += chunk;
+      size -= chunk;
+    }
+  prd[-1].flags = PRD_EOT;
+
+  outl (reg_bm_prdt (c), vtop (c->prdt));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_ERROR | BM_STA_INTR);
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+
+  sema_down (&c->completion_wait);
+  bm_status = inb (reg_bm_status (c));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c), bm_status | BM_STA_ERROR | BM_STA_INTR);
+  return ((bm_status & BM_STA_ERROR) == 0
+          && (inb (reg_status (c)) & STA_ERR) == 0);
+}
+
+/* Reads CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   from disk D into BUFFER by DMA.  An odd BUFFER goes through
+   the channel's bounce buffer. */
+static void
+dma_read (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+
+  if (((uintptr_t) buffer & 1) == 0)
+    {
+      if (!dma_transfer (d, sec_no, cnt, buffer, false))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+      return;
+    }
+
+  while (cnt > 0)
+    {
+      size_t chunk = cnt < BOUNCE_SECTORS ? cnt : BOUNCE_SECTORS;
+      if (!dma_transfer (d, sec_no, chunk, c->bounce, false))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
+      memcpy (buffer, c->bounce, chunk * BLOCK_SECTOR_SIZE);
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      sec_no += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Writes CNT sectors, at most MAX_CMD_SECTORS, starting at SEC_NO
+   to disk D from BUFFER by DMA.  An odd BUFFER goes through the
+   channel's bounce buffer. */
+static void
+dma_write (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+           const uint8_t *buffer)
+{
+  struct channel *c = d->channel;
+
+  if (((uintptr_t) buffer & 1) == 0)
+    {
+      if (!dma_transfer (d, sec_no, cnt, buffer, true))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+      return;
+    }
+
+  while (cnt > 0)
+    {
+      size_t chunk = cnt < BOUNCE_SECTORS ? cnt : BOUNCE_SECTORS;
+      memcpy (c->bounce, buffer, chunk * BLOCK_SECTOR_SIZE);
+      if (!dma_transfer (d, sec_no, chunk, c->bounce, true))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      sec_no += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      size_t cmd_cnt = cnt < MAX_CMD_SECTORS ? cnt : MAX_CMD_SECTORS;
+      if (d->dma)
+        dma_read (d, sec_no, cmd_cnt, buffer);
+      else
+        pio_read (d, sec_no, cmd_cnt, buffer);
+      buffer += cmd_cnt * BLOCK_SECTOR_SIZE;
+      sec_no += cmd_cnt;
+      cnt -= cmd_cnt;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving the data.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      size_t cmd_cnt = cnt < MAX_CMD_SECTORS ? cnt : MAX_CMD_SECTORS;
+      if (d->dma)
+        dma_write (d, sec_no, cmd_cnt, buffer);
+      else
+        pio_write (d, sec_no, cmd_cnt, buffer);
+      buffer += cmd_cnt * BLOCK_SECTOR_SIZE;
+      sec_no += cmd_cnt;
+      cnt -= cmd_cnt;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple,
+    NULL,
+    NULL
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT, which must be between 1 and
+   MAX_CMD_SECTORS, to the disk's sector selection registers.
+   (We use LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_CMD_SECTORS);
 
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -414,20 +791,22 @@ issue_pio_command (struct channel *c, uint8_t command)
   outb (reg_command (c), command);
 }
 
-/* Reads a sector from channel C's data register in PIO mode into
-   SECTOR, which must have room for BLOCK_SECTOR_SIZE bytes. */
+/* Reads CNT sectors from channel C's data register in PIO mode
+   into SECTOR, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-input_sector (struct channel *c, void *sector)
+input_sector (struct channel *c, void *sector, size_t cnt)
 {
-  insw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  insw (reg_data (c), sector, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
-/* Writes SECTOR to channel C's data register in PIO mode.
-   SECTOR must contain BLOCK_SECTOR_SIZE bytes. */
+/* Writes CNT sectors to channel C's data register in PIO mode
+   from SECTOR, which must contain CNT * BLOCK_SECTOR_SIZE
+   bytes. */
 static void
-output_sector (struct channel *c, const void *sector)
+output_sector (struct channel *c, const void *sector, size_t cnt)
 {
-  outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
+  outsw (reg_data (c), sector, cnt * BLOCK_SECTOR_SIZE / 2);
 }
 
 /* Low-level ATA primitives. */
@@ -2,7 +2,7 @@
 #include <debug.h>
 #include "threads/thread.h"
 
-static int next (int pos);
+static int next (const struct intq *q, int pos);
 static void wait (struct intq *q, struct thread **waiter);
 static void signal (struct intq *q, struct thread **waiter);
 
@@ -12,9 +12,33 @@ intq_init (struct intq *q)
 {
   lock_init (&q->lock);
   q->not_full = q->not_empty = NULL;
+  q->buf = q->default_buf;
+  q->size = INTQ_BUFSIZE;
   q->head = q->tail = 0;
 }
 
+/* Makes Q use the SIZE bytes in BUF as its buffer, keeping the
+   bytes it already holds, which must fit.  The old buffer is not
+   freed.  Interrupts must be off. */
+void
+intq_set_buffer (struct intq *q, uint8_t *buf, int size)
+{
+  int cnt = 0;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (size >= 2);
+
+  for (; !intq_empty (q); q->tail = next (q, q->tail))
+    {
+      ASSERT (cnt < size - 1);
+      buf[cnt++] = q->buf[q->tail];
+    }
+  q->buf = buf;
+  q->size = size;
+  q->tail = 0;
+  q->head = cnt;
+}
+
 /* Returns true if Q is empty, false otherwise. */
 bool
 intq_empty (const struct intq *q)
@@ -28,7 +52,7 @@ bool
 intq_full (const struct intq *q)
 {
   ASSERT (intr_get_level () == INTR_OFF);
-  return next (q->head) == q->tail;
+  return next (q, q->head) == q->tail;
 }
 
 /* Removes a byte from Q and returns it.
@@ -49,7 +73,7 @@ intq_getc (struct intq *q)
     }
 
   byte = q->buf[q->tail];
-  q->tail = next (q->tail);
+  q->tail = next (q, q->tail);
   signal (q, &q->not_full);
   return byte;
 }
@@ -70,15 +94,15 @@ intq_putc (struct intq *q, uint8_t byte)
     }
 
   q->buf[q->head] = byte;
-  q->head = next (q->head);
+  q->head = next (q, q->head);
   signal (q, &q->not_empty);
 }
 
-/* Returns the position after POS within an intq. */
+/* Returns the position after POS within Q. */
 static int
-next (int pos)
+next (const struct intq *q, int pos)
 {
-  return (pos + 1) % INTQ_BUFSIZE;
+  return (pos + 1) % q->size;
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
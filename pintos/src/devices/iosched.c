@@ -0,0 +1,114 @@
+#include "devices/iosched.h"
+#include <debug.h>
+#include <string.h>
+#include "devices/timer.h"
+
+/* How long the deadline scheduler lets a request wait, in timer
+   ticks, before serving it ahead of the sweep.  Readers usually
+   wait for their data, writers usually don't, so reads expire
+   sooner. */
+#define READ_EXPIRE (TIMER_FREQ / 20)
+#define WRITE_EXPIRE (TIMER_FREQ / 2)
+
+static struct block_request *
+request_entry (struct list_elem *e)
+{
+  return list_entry (e, struct block_request, elem);
+}
+
+/* No-op scheduler: first come, first served. */
+static struct block_request *
+noop_select (struct list *queue, struct iosched_head *head UNUSED)
+{
+  return request_entry (list_front (queue));
+}
+
+/* Returns the request in QUEUE nearest to HEAD in HEAD's
+   direction, or a null pointer if there is none. */
+static struct block_request *
+nearest (struct list *queue, const struct iosched_head *head)
+{
+  struct block_request *best = NULL;
+  struct list_elem *e;
+
+  for (e = list_begin (queue); e != list_end (queue); e = list_next (e))
+    {
+      struct block_request *r = request_entry (e);
+      if (head->down
+          ? r->sector <= head->sector
+            && (best == NULL || r->sector > best->sector)
+          : r->sector >= head->sector
+            && (best == NULL || r->sector < best->sector))
+        best = r;
+    }
+  return best;
+}
+
+/* Elevator scheduler: serves requests in sector order, sweeping
+   up and down across the disk and turning around when there is
+   nothing further ahead (the LOOK variant of SCAN). */
+static struct block_request *
+scan_select (struct list *queue, struct iosched_head *head)
+{
+  struct block_request *r = nearest (queue, head);
+  if (r == NULL)
+    {
+      head->down = !head->down;
+      r = nearest (queue, head);
+    }
+  ASSERT (r != NULL);
+  return r;
+}
+
+/* Deadline scheduler: the elevator, except that a request that
+   has waited longer than READ_EXPIRE or WRITE_EXPIRE goes first,
+   so that no request starves at the far end of the disk. */
+static struct block_request *
+deadline_select (struct list *queue, struct iosched_head *head)
+{
+  struct block_request *oldest = NULL;
+  int64_t oldest_deadline = 0;
+  struct list_elem *e;
+
+  for (e = list_begin (queue); e != list_end (queue); e = list_next (e))
+    {
+      struct block_request *r = request_entry (e);
+      int64_t deadline = r->submitted + (r->write ? WRITE_EXPIRE
+                                                  : READ_EXPIRE);
+      if (oldest == NULL || deadline < oldest_deadline)
+        {
+          oldest = r;
+          oldest_deadline = deadline;
+        }
+    }
+
+  if (oldest_deadline <= timer_ticks ())
+    {
+      head->down = oldest->sector < head->sector;
+      return oldest;
+    }
+  return scan_select (queue, head);
+}
+
+const struct iosched iosched_noop = {"noop", noop_select};
+const struct iosched iosched_scan = {"scan", scan_select};
+const struct iosched iosched_deadline = {"deadline", deadline_select};
+
+/* Returns the scheduler called NAME, or a null pointer if there
+   is none. */
+const struct iosched *
+iosched_find (const char *name)
+{
+  static const struct iosched *schedulers[] =
+    {
+      &iosched_noop,
+      &iosched_scan,
+      &iosched_deadline,
+    };
+  size_t i;
+
+  for (i = 0; i < sizeof schedulers / sizeof *schedulers; i++)
+    if (!strcmp (name, schedulers[i]->name))
+      return schedulers[i];
+  return NULL;
+}
@@ -0,0 +1,34 @@
+#ifndef DEVICES_IOSCHED_H
+#define DEVICES_IOSCHED_H
+
+#include <list.h>
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Disk head position, as seen by an I/O scheduler. */
+struct iosched_head
+  {
+    block_sector_t sector;      /* Sector after the last request. */
+    bool down;                  /* Sweeping toward sector 0? */
+  };
+
+/* An I/O scheduler: a policy for the order in which a block
+   device's queued requests are dispatched. */
+struct iosched
+  {
+    const char *name;           /* Name, for the "-iosched" option. */
+
+    /* Returns the request in QUEUE, a nonempty list of struct
+       block_request in arrival order, to dispatch next.  May
+       update HEAD's direction; the caller updates its sector. */
+    struct block_request *(*select) (struct list *queue,
+                                     struct iosched_head *head);
+  };
+
+extern const struct iosched iosched_noop;
+extern const struct iosched iosched_scan;
+extern const struct iosched iosched_deadline;
+
+const struct iosched *iosched_find (const char *name);
+
+#endif /* devices/iosched.h */
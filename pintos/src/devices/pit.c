@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -81,3 +78,33 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts channel 0 counting down from COUNT in mode 0, so that
+   it raises interrupt line 0 once, COUNT PIT cycles from now.  A
+   COUNT of 0 is treated as 65536.  Afterward the counter keeps
+   counting down, wrapping around, but raises no more interrupts
+   until it is started again. */
+void
+pit_start_oneshot (uint16_t count)
+{
+  enum intr_level old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0x30);
+  outb (PIT_PORT_COUNTER (0), count);
+  outb (PIT_PORT_COUNTER (0), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of channel 0's counter. */
+uint16_t
+pit_read_count (void)
+{
+  enum intr_level old_level;
+  uint16_t count;
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, 0x00);        /* Latch channel 0. */
+  count = inb (PIT_PORT_COUNTER (0));
+  count |= inb (PIT_PORT_COUNTER (0)) << 8;
+  intr_set_level (old_level);
+  return count;
+}
@@ -0,0 +1,128 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A RAM disk: a block device whose sectors are kept in pages
+   from the kernel pool.  It registers as raw device "rd0", which
+   can be given any role by name, e.g. "-filesys=rd0" or
+   "-swap=rd0".  Its contents are zeros at boot and are lost at
+   shutdown. */
+
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+size_t ramdisk_kb;
+
+/* A RAM disk.  The pages need not be contiguous. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Pages holding the sectors. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Creates the RAM disk, if one was requested, and registers it
+   with the block device layer.  If the kernel pool cannot supply
+   all of it, makes do with what it gets. */
+void
+ramdisk_init (void)
+{
+  struct ramdisk *rd;
+  size_t want, i;
+
+  if (ramdisk_kb == 0)
+    return;
+
+  want = DIV_ROUND_UP (ramdisk_kb * 1024, PGSIZE);
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("Failed to allocate memory for RAM disk descriptor");
+  rd->pages = malloc (want * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("Failed to allocate memory for RAM disk page table");
+
+  for (i = 0; i < want; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        break;
+    }
+  rd->page_cnt = i;
+  if (rd->page_cnt < want)
+    printf ("rd0: only %zu of %zu kB available\n",
+            rd->page_cnt * PGSIZE / 1024, want * PGSIZE / 1024);
+  if (rd->page_cnt == 0)
+    {
+      free (rd->pages);
+      free (rd);
+      return;
+    }
+
+  block_register ("rd0", BLOCK_RAW, "RAM disk",
+                  rd->page_cnt * SECTORS_PER_PAGE, &ramdisk_operations, rd);
+}
+
+/* Returns the address of SECTOR in RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  ASSERT (sector / SECTORS_PER_PAGE < rd->page_cnt);
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads CNT sectors starting at SECTOR from RAM disk RD_ into
+   BUFFER. */
+static void
+ramdisk_read_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                       void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *buffer = buffer_;
+
+  for (; cnt > 0; cnt--, sector++, buffer += BLOCK_SECTOR_SIZE)
+    memcpy (buffer, sector_addr (rd, sector), BLOCK_SECTOR_SIZE);
+}
+
+/* Writes CNT sectors starting at SECTOR to RAM disk RD_ from
+   BUFFER. */
+static void
+ramdisk_write_multiple (void *rd_, block_sector_t sector, size_t cnt,
+                        const void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *buffer = buffer_;
+
+  for (; cnt > 0; cnt--, sector++, buffer += BLOCK_SECTOR_SIZE)
+    memcpy (sector_addr (rd, sector), buffer, BLOCK_SECTOR_SIZE);
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multiple (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multiple (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multiple,
+    ramdisk_write_multiple,
+    NULL,
+    NULL
+  };
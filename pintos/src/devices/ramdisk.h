@@ -0,0 +1,12 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include <stddef.h>
+
+/* Size of the RAM disk in kB, 0 for none.  Controlled by kernel
+   command-line option "-ramdisk=KB". */
+extern size_t ramdisk_kb;
+
+void ramdisk_init (void);
+
+#endif /* devices/ramdisk.h */
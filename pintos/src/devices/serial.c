@@ -5,6 +5,7 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -33,6 +34,18 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* FIFOs enabled (16550A and later). */
+
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Clear receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Clear transmit FIFO. */
+#define FCR_TRIGGER_8 0x80      /* Receive interrupt at 8 bytes. */
+
+/* Size of the 16550A transmit FIFO, in bytes. */
+#define TX_FIFO_SIZE 16
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -53,8 +66,19 @@ static enum { UNINIT, POLL, QUEUE } mode;
 
 /* Data to be transmitted. */
 static struct intq txq;
+size_t serial_buf_size;
+
+/* Bytes the UART can accept in one burst: TX_FIFO_SIZE if it has
+   a working FIFO, otherwise 1. */
+static int tx_burst;
+
+/* Bytes that can be written to THR without overrunning the
+   transmit FIFO.  The UART only ever drains the FIFO, so this is
+   a lower bound on its free space. */
+static int tx_room;
 
 static void set_serial (int bps);
+static bool tx_ready (void);
 static void putc_poll (uint8_t);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
@@ -68,7 +92,9 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX | FCR_TRIGGER_8);
+  tx_burst = (inb (IIR_REG) & IIR_FIFO) == IIR_FIFO ? TX_FIFO_SIZE : 1;
+  tx_room = 0;
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
@@ -77,19 +103,26 @@ init_poll (void)
 
 /* Initializes the serial port device for queued interrupt-driven
    I/O.  With interrupt-driven I/O we don't waste CPU time
-   waiting for the serial device to become ready. */
+   waiting for the serial device to become ready.  Also gives the
+   transmit queue a buffer of SERIAL_BUF_SIZE bytes, if set. */
 void
 serial_init_queue (void)
 {
   enum intr_level old_level;
+  uint8_t *buf = NULL;
 
   if (mode == UNINIT)
     init_poll ();
   ASSERT (mode == POLL);
 
+  if (serial_buf_size > INTQ_BUFSIZE)
+    buf = malloc (serial_buf_size);
+
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
   mode = QUEUE;
   old_level = intr_disable ();
+  if (buf != NULL)
+    intq_set_buffer (&txq, buf, (int) serial_buf_size);
   write_ier ();
   intr_set_level (old_level);
 }
@@ -118,7 +151,9 @@ serial_putc (uint8_t byte)
              If we wanted to wait for the queue to empty,
              we'd have to reenable interrupts.
              That's impolite, so we'll send a character via
-             polling instead. */
+             polling instead.  Only one: a burst would keep
+             interrupts off long enough for a tickless timer to
+             lose time. */
           putc_poll (intq_getc (&txq));
         }
 
@@ -193,6 +228,19 @@ write_ier (void)
   outb (IER_REG, ier);
 }
 
+/* Returns true if the transmit FIFO has room for a byte.
+   Once the UART reports it empty, the next TX_BURST bytes can be
+   written without checking again. */
+static bool
+tx_ready (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (tx_room == 0 && (inb (LSR_REG) & LSR_THRE) != 0)
+    tx_room = tx_burst;
+  return tx_room > 0;
+}
+
 /* Polls the serial port until it's ready,
    and then transmits BYTE. */
 static void
@@ -200,9 +248,10 @@ putc_poll (uint8_t byte)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
-  while ((inb (LSR_REG) & LSR_THRE) == 0)
+  while (!tx_ready ())
     continue;
   outb (THR_REG, byte);
+  tx_room--;
 }
 
 /* Serial interrupt handler. */
@@ -219,9 +268,14 @@ serial_interrupt (struct intr_frame *f UNUSED)
     input_putc (inb (RBR_REG));
 
   /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
-    outb (THR_REG, intq_getc (&txq));
+     ready to accept a byte for transmission, transmit a byte.
+     With the FIFO this refills up to TX_FIFO_SIZE bytes per
+     interrupt. */
+  while (!intq_empty (&txq) && tx_ready ())
+    {
+      outb (THR_REG, intq_getc (&txq));
+      tx_room--;
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
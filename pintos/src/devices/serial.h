@@ -1,8 +1,13 @@
 #ifndef DEVICES_SERIAL_H
 #define DEVICES_SERIAL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+/* Size of the transmit queue in bytes, 0 for the default.
+   Controlled by kernel command-line option "-serial-buf=BYTES". */
+extern size_t serial_buf_size;
+
 void serial_init_queue (void);
 void serial_putc (uint8_t);
 void serial_flush (void);
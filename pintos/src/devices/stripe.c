@@ -0,0 +1,184 @@
+#include "devices/stripe.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+
+/* A striped (RAID-0) device: a block device whose sectors are
+   spread over several member devices in chunks of STRIPE_CHUNK
+   sectors, round robin.  It registers as raw device "md0", which
+   can be given any role by name, e.g. "-filesys=md0" or
+   "-swap=md0".  The members should not be given roles
+   themselves.
+
+   Chunk C of the device is chunk C / N of member C % N, where N
+   is the number of members, so a large request keeps all of the
+   members busy at once.  Each request is split into one request
+   per chunk, which are submitted to the members' queues and
+   complete independently. */
+
+/* Maximum number of members. */
+#define STRIPE_MAX 8
+
+char *stripe_members;
+unsigned stripe_chunk = 16;
+
+/* A striped device. */
+struct stripe
+  {
+    struct block *members[STRIPE_MAX];  /* Member devices. */
+    size_t member_cnt;                  /* Number of members. */
+    block_sector_t chunk;               /* Sectors per chunk. */
+  };
+
+/* A request to a striped device, split up among its members. */
+struct stripe_io
+  {
+    struct block_request *parent;       /* Request being served. */
+    size_t pending;                     /* Parts not yet completed. */
+    struct block_request parts[];       /* One per chunk touched. */
+  };
+
+static struct block_operations stripe_operations;
+
+/* Creates the striped device, if one was requested, and
+   registers it with the block device layer. */
+void
+stripe_init (void)
+{
+  struct stripe *s;
+  block_sector_t member_size = 0;
+  char *name, *save_ptr;
+
+  if (stripe_members == NULL)
+    return;
+  if (stripe_chunk == 0)
+    PANIC ("stripe chunk size must be positive");
+
+  s = malloc (sizeof *s);
+  if (s == NULL)
+    PANIC ("Failed to allocate memory for striped device descriptor");
+  s->member_cnt = 0;
+  s->chunk = stripe_chunk;
+  for (name = strtok_r (stripe_members, ",", &save_ptr); name != NULL;
+       name = strtok_r (NULL, ",", &save_ptr))
+    {
+      struct block *member = block_get_by_name (name);
+      if (member == NULL)
+        PANIC ("stripe: no block device named \"%s\"", name);
+      if (s->member_cnt >= STRIPE_MAX)
+        PANIC ("stripe: more than %d members", STRIPE_MAX);
+      if (s->member_cnt == 0 || block_size (member) < member_size)
+        member_size = block_size (member);
+      s->members[s->member_cnt++] = member;
+    }
+  if (s->member_cnt == 0)
+    PANIC ("stripe: no member devices");
+
+  member_size -= member_size % s->chunk;
+  if (member_size == 0)
+    PANIC ("stripe: members smaller than one %"PRDSNu"-sector chunk",
+           s->chunk);
+  block_register ("md0", BLOCK_RAW, "RAID-0", member_size * s->member_cnt,
+                  &stripe_operations, s);
+}
+
+/* Translates SECTOR of striped device S into a sector of one of
+   its members, which it stores in *MEMBER_SECTOR and returns. */
+static struct block *
+map_sector (const struct stripe *s, block_sector_t sector,
+            block_sector_t *member_sector)
+{
+  block_sector_t chunk = sector / s->chunk;
+
+  *member_sector = chunk / s->member_cnt * s->chunk + sector % s->chunk;
+  return s->members[chunk % s->member_cnt];
+}
+
+/* Completion callback for part REQ of a striped request.
+   Completes the whole request once its last part is done. */
+static void
+part_complete (struct block_request *req)
+{
+  struct stripe_io *io = req->aux;
+  enum intr_level old_level;
+  bool last;
+
+  old_level = intr_disable ();
+  last = --io->pending == 0;
+  intr_set_level (old_level);
+
+  if (last)
+    {
+      block_complete (io->parent);
+      free (io);
+    }
+}
+
+/* Splits REQ into one request per chunk and submits them to the
+   members of striped device S_. */
+static void
+stripe_submit (void *s_, struct block_request *req)
+{
+  struct stripe *s = s_;
+  block_sector_t sector = req->sector;
+  size_t left = req->cnt;
+  uint8_t *buffer = req->buffer;
+  struct stripe_io *io;
+  size_t part_cnt, i;
+
+  part_cnt = (sector + left - 1) / s->chunk - sector / s->chunk + 1;
+  io = malloc (sizeof *io + part_cnt * sizeof *io->parts);
+  if (io == NULL)
+    PANIC ("Failed to allocate memory for striped request");
+  io->parent = req;
+  io->pending = part_cnt;
+
+  for (i = 0; i < part_cnt; i++)
+    {
+      struct block_request *part = &io->parts[i];
+      block_sector_t member_sector;
+      struct block *member = map_sector (s, sector, &member_sector);
+      size_t cnt = s->chunk - sector % s->chunk;
+
+      if (cnt > left)
+        cnt = left;
+      block_request_init (part, req->write, member_sector, cnt, buffer,
+                          part_complete, io);
+      block_submit (member, part);
+
+      sector += cnt;
+      left -= cnt;
+      buffer += cnt * BLOCK_SECTOR_SIZE;
+    }
+}
+
+/* Reads sector SECTOR from striped device S into BUFFER. */
+static void
+stripe_read (void *s, block_sector_t sector, void *buffer)
+{
+  block_sector_t member_sector;
+  struct block *member = map_sector (s, sector, &member_sector);
+  block_read (member, member_sector, buffer);
+}
+
+/* Writes sector SECTOR to striped device S from BUFFER. */
+static void
+stripe_write (void *s, block_sector_t sector, const void *buffer)
+{
+  block_sector_t member_sector;
+  struct block *member = map_sector (s, sector, &member_sector);
+  block_write (member, member_sector, buffer);
+}
+
+static struct block_operations stripe_operations =
+  {
+    stripe_read,
+    stripe_write,
+    NULL,
+    NULL,
+    NULL,
+    stripe_submit
+  };
@@ -0,0 +1,15 @@
+#ifndef DEVICES_STRIPE_H
+#define DEVICES_STRIPE_H
+
+/* Comma-separated names of the devices to stripe across, or null
+   for none.  Controlled by kernel command-line option
+   "-stripe=DEV,DEV,...". */
+extern char *stripe_members;
+
+/* Size of a stripe chunk in sectors.  Controlled by kernel
+   command-line option "-stripe-chunk=SECTORS". */
+extern unsigned stripe_chunk;
+
+void stripe_init (void);
+
+#endif /* devices/stripe.h */
@@ -17,37 +17,116 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
+/* PIT cycles per timer tick. */
+#define TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Bounds on a one-shot interval, in PIT cycles.  Shorter sleeps
+   busy-wait, since the interrupt would cost more than they do.
+   The upper bound leaves room to tell a counter that has wrapped
+   past zero from one that has not. */
+#define ONESHOT_MIN 12                  /* About 10 us. */
+#define ONESHOT_MAX 60000               /* About 50 ms. */
+
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
-/* Wait list for threads. */
-static struct list wait_list;
+/* Timer wheel.
+
+   Pending timers hang off a hierarchy of WHEEL_LEVELS wheels of
+   WHEEL_SLOTS slots each, in units of 2**WHEEL_UNIT_BITS clock
+   cycles.  A timer that expires less than WHEEL_SLOTS units from
+   now is in level 0, in the slot for its expiry unit.  Otherwise it is
+   in the first level L whose slots, of WHEEL_SLOTS**L units
+   each, reach its expiry, and it moves ("cascades") to a lower
+   level when the wheel reaches the start of its slot.  Adding
+   and canceling a timer thus take constant time, and each timer
+   cascades at most WHEEL_LEVELS - 1 times before it expires.
+
+   The wheel has processed every unit before wheel_base.  A
+   bitmap of the nonempty slots in each level lets it skip
+   straight to the next unit at which anything happens.  Canceling
+   a timer leaves its bit set, to be cleared lazily. */
+#define WHEEL_UNIT_BITS 6               /* 64 cycles, about 54 us. */
+#define WHEEL_SLOT_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_SLOT_BITS)
+#define WHEEL_LEVELS 6
+#define WHEEL_SPAN (1ULL << (WHEEL_SLOT_BITS * WHEEL_LEVELS))
+static struct list wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static uint64_t wheel_used[WHEEL_LEVELS];  /* Nonempty slots. */
+static uint64_t wheel_base;             /* Next unit to process. */
+
+/* If false (default), the PIT interrupts TIMER_FREQ times per
+   second.  If true, it is programmed in one-shot mode for the
+   next event only.  Controlled by kernel command-line option
+   "-tickless". */
+bool timer_tickless;
+
+/* The clock counts PIT cycles since the OS booted.  The current
+   PIT period, of PERIOD cycles, started at CLOCK_BASE. */
+static int64_t clock_base;
+static unsigned period;
+static int64_t last_clock;              /* Last value of clock_now(). */
+
+/* In tickless mode, whether the CPU is idle, in which case the
+   timer need not interrupt at tick boundaries. */
+static bool idle;
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Time-stamp counter frequency, in Hz, and a reading of the
+   counter at TSC_BASE_NS nanoseconds since boot.  Initialized by
+   timer_calibrate(); until then timer_ns() uses the PIT clock. */
+static uint64_t tsc_hz;
+static uint64_t tsc_base;
+static int64_t tsc_base_ns;
+
+/* Timer ticks over which to measure the time-stamp counter. */
+#define TSC_CALIBRATION_TICKS 5
+
+#define NS_PER_SEC 1000000000
+
 static intr_handler_func timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
-
-/* Sets up the timer to interrupt TIMER_FREQ times per second,
-   and registers the corresponding interrupt. */
+static int64_t clock_now (void);
+static void program_next (int64_t now);
+static uint64_t wheel_next (void);
+static void wheel_insert (struct timer *);
+static void run_timers (int64_t now);
+static void sleep_until (int64_t deadline);
+static int64_t to_ns (uint64_t count, uint64_t hz);
+
+/* Sets up the timer to interrupt TIMER_FREQ times per second, or
+   at the first tick in tickless mode, and registers the
+   corresponding interrupt. */
 void
 timer_init (void)
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  int level, slot;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SLOTS; slot++)
+      list_init (&wheel[level][slot]);
+  period = TICK_CYCLES;
+  if (timer_tickless)
+    pit_start_oneshot (period);
+  else
+    pit_configure_channel (0, 2, TIMER_FREQ);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
-  list_init(&wait_list);
 }
 
-/* Calibrates loops_per_tick, used to implement brief delays. */
+/* Calibrates loops_per_tick, used to implement brief delays,
+   and the time-stamp counter, used by timer_ns(). */
 void
 timer_calibrate (void)
 {
   unsigned high_bit, test_bit;
+  int64_t start, clock0, clock1;
+  uint64_t tsc0, tsc1;
 
   ASSERT (intr_get_level () == INTR_ON);
   printf ("Calibrating timer...  ");
@@ -67,7 +146,35 @@ timer_calibrate (void)
     if (!too_many_loops (high_bit | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  /* Count time-stamp counter cycles against the PIT clock. */
+  start = ticks;
+  while (ticks == start)
+    barrier ();
+  clock0 = timer_clock ();
+  tsc0 = timer_cycles ();
+  while (ticks - start <= TSC_CALIBRATION_TICKS)
+    barrier ();
+  clock1 = timer_clock ();
+  tsc1 = timer_cycles ();
+  if (clock1 > clock0 && tsc1 > tsc0)
+    {
+      tsc_base_ns = to_ns (clock1, PIT_HZ);
+      tsc_base = tsc1;
+      tsc_hz = (tsc1 - tsc0) * PIT_HZ / (clock1 - clock0);
+    }
+
+  printf ("%'"PRIu64" loops/s, %'"PRIu64" TSC cycles/s.\n",
+          (uint64_t) loops_per_tick * TIMER_FREQ, tsc_hz);
+}
+
+/* Returns the number of nanoseconds since the OS booted, read
+   from the time-stamp counter once it has been calibrated. */
+int64_t
+timer_ns (void)
+{
+  if (tsc_hz == 0)
+    return to_ns (timer_clock (), PIT_HZ);
+  return tsc_base_ns + to_ns (timer_cycles () - tsc_base, tsc_hz);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -105,9 +212,78 @@ timer_sleep (int64_t ticks)
   int64_t start = timer_ticks ();
 
   ASSERT (intr_get_level () == INTR_ON);
-  intr_disable();
-  thread_sleep(start + ticks);
-  intr_enable();
+  sleep_until ((start + ticks) * TICK_CYCLES);
+}
+
+/* Tells the timer that the CPU is about to go idle, if IS_IDLE
+   is true, or to run a thread.  In tickless mode, the timer stops
+   interrupting at every tick while the CPU is idle.  Interrupts
+   must be off. */
+void
+timer_set_idle (bool is_idle)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (timer_tickless && idle != is_idle)
+    {
+      idle = is_idle;
+      program_next (clock_now ());
+    }
+}
+
+/* Returns the clock, in units of 1/TIMER_CLOCK_FREQ seconds
+   since the OS booted. */
+int64_t
+timer_clock (void)
+{
+  enum intr_level old_level = intr_disable ();
+  int64_t now = clock_now ();
+  intr_set_level (old_level);
+  return now;
+}
+
+/* Initializes timer T to call FUNC, passing T itself, when it
+   expires.  FUNC can find AUX in T->aux. */
+void
+timer_setup (struct timer *t, timer_func *func, void *aux)
+{
+  t->func = func;
+  t->aux = aux;
+  t->pending = false;
+}
+
+/* Arranges for timer T to expire when the clock reaches EXPIRES,
+   canceling it first if it is pending.  T's function will then
+   be called from the timer interrupt, so it must not sleep.  T
+   must not be freed while it is pending. */
+void
+timer_add (struct timer *t, int64_t expires)
+{
+  enum intr_level old_level = intr_disable ();
+
+  timer_cancel (t);
+  t->expires = expires;
+  t->pending = true;
+  wheel_insert (t);
+  if (timer_tickless && expires < clock_base + period)
+    program_next (clock_now ());
+  intr_set_level (old_level);
+}
+
+/* Cancels timer T.  Returns true if it was pending, false if it
+   had already expired or was never added. */
+bool
+timer_cancel (struct timer *t)
+{
+  enum intr_level old_level = intr_disable ();
+  bool was_pending = t->pending;
+
+  if (was_pending)
+    {
+      list_remove (&t->elem);
+      t->pending = false;
+    }
+  intr_set_level (old_level);
+  return was_pending;
 }
 
 /* Sleeps for approximately MS milliseconds.  Interrupts must be
@@ -180,11 +356,277 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Timer interrupt handler.  In tickless mode, the interrupt may
+   come after several ticks, or between two of them. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick(ticks);
+  int64_t now;
+
+  if (!timer_tickless)
+    {
+      clock_base += period;
+      ticks++;
+      thread_tick(ticks);
+      run_timers (clock_now ());
+      return;
+    }
+
+  now = clock_now ();
+  while ((ticks + 1) * TICK_CYCLES <= now)
+    {
+      ticks++;
+      thread_tick(ticks);
+    }
+  run_timers (now);
+  program_next (now);
+}
+
+/* Returns the clock, in PIT cycles since the OS booted.
+   Interrupts must be off. */
+static int64_t
+clock_now (void)
+{
+  uint16_t count = pit_read_count ();
+  int64_t now;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* A one-shot counter keeps counting down past zero. */
+  if (count <= period)
+    now = clock_base + (period - count);
+  else
+    now = clock_base + period + (65536 - count);
+
+  /* A periodic counter reloads before its interrupt is handled,
+     so don't let the clock run backward. */
+  if (now < last_clock)
+    now = last_clock;
+  last_clock = now;
+  return now;
+}
+
+/* Programs the PIT, in tickless mode, to interrupt at the next
+   event after NOW: the next tick, unless the CPU is idle, or the
+   next time the timer wheel has work to do.  Interrupts must be
+   off. */
+static void
+program_next (int64_t now)
+{
+  int64_t deadline = idle ? now + ONESHOT_MAX : (ticks + 1) * TICK_CYCLES;
+  uint64_t unit = wheel_next ();
+  int64_t delta;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (unit != UINT64_MAX && (int64_t) (unit << WHEEL_UNIT_BITS) < deadline)
+    deadline = unit << WHEEL_UNIT_BITS;
+
+  delta = deadline - now;
+  if (delta < ONESHOT_MIN)
+    delta = ONESHOT_MIN;
+  else if (delta > ONESHOT_MAX)
+    delta = ONESHOT_MAX;
+
+  clock_base = now;
+  period = delta;
+  pit_start_oneshot (period);
+}
+
+/* Returns the index of the first set bit in BITS at or after
+   bit START, wrapping around, as a distance from START, or 64 if
+   BITS is 0. */
+static int
+first_bit_from (uint64_t bits, int start)
+{
+  uint32_t lo, hi;
+
+  if (start != 0)
+    bits = (bits >> start) | (bits << (64 - start));
+  lo = bits;
+  hi = bits >> 32;
+  if (lo != 0)
+    return __builtin_ctz (lo);
+  else if (hi != 0)
+    return 32 + __builtin_ctz (hi);
+  else
+    return 64;
+}
+
+/* Returns the unit at which slot SLOT of wheel level LEVEL is
+   next processed: run, for level 0, or cascaded. */
+static uint64_t
+slot_unit (int level, int slot)
+{
+  int shift = WHEEL_SLOT_BITS * level;
+  uint64_t round = wheel_base >> shift;
+  int k = (slot - (int) (round % WHEEL_SLOTS) + WHEEL_SLOTS) % WHEEL_SLOTS;
+
+  /* The current slot of a higher level was cascaded at the start
+     of this round, unless the round is only now beginning. */
+  if (k == 0 && (wheel_base & ((1ULL << shift) - 1)) != 0)
+    k = WHEEL_SLOTS;
+  return (round + k) << shift;
+}
+
+/* Returns the next unit at which the wheel has a slot to run or
+   to cascade, or UINT64_MAX if it is empty. */
+static uint64_t
+wheel_next (void)
+{
+  uint64_t next = UINT64_MAX;
+  int level;
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    {
+      int cur = (wheel_base >> (WHEEL_SLOT_BITS * level)) % WHEEL_SLOTS;
+      int k;
+
+      while ((k = first_bit_from (wheel_used[level], cur)) < WHEEL_SLOTS)
+        {
+          int slot = (cur + k) % WHEEL_SLOTS;
+          if (!list_empty (&wheel[level][slot]))
+            {
+              uint64_t unit = slot_unit (level, slot);
+              if (unit < next)
+                next = unit;
+              break;
+            }
+
+          /* Canceled timers left the slot empty. */
+          wheel_used[level] &= ~(1ULL << slot);
+        }
+    }
+  return next;
+}
+
+/* Puts pending timer T into the wheel slot for its expiry time.
+   Interrupts must be off. */
+static void
+wheel_insert (struct timer *t)
+{
+  uint64_t unit, delta;
+  int level, slot;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* The unit it expires in, but not in the past. */
+  unit = t->expires > 0 ? (uint64_t) t->expires >> WHEEL_UNIT_BITS : 0;
+  if (unit < wheel_base)
+    unit = wheel_base;
+  delta = unit - wheel_base;
+  if (delta >= WHEEL_SPAN)
+    {
+      /* Park it as far out as the wheel reaches.  It is
+         reinserted from there. */
+      delta = WHEEL_SPAN - 1;
+      unit = wheel_base + delta;
+    }
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < 1ULL << (WHEEL_SLOT_BITS * (level + 1)))
+      break;
+  slot = (unit >> (WHEEL_SLOT_BITS * level)) % WHEEL_SLOTS;
+  list_push_back (&wheel[level][slot], &t->elem);
+  wheel_used[level] |= 1ULL << slot;
+}
+
+/* Processes unit wheel_base: cascades the higher-level slots
+   that start there, then moves the timers in its level 0 slot
+   that have expired by clock value NOW to EXPIRED.  Timers later
+   in the unit than NOW, which is possible only in the unit NOW
+   is in, go to LATER. */
+static void
+wheel_step (struct list *expired, struct list *later, int64_t now)
+{
+  int level;
+
+  for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+      int shift = WHEEL_SLOT_BITS * level;
+      int slot = (wheel_base >> shift) % WHEEL_SLOTS;
+      struct list *list = &wheel[level][slot];
+
+      if ((wheel_base & ((1ULL << shift) - 1)) != 0)
+        break;
+      wheel_used[level] &= ~(1ULL << slot);
+      while (!list_empty (list))
+        wheel_insert (list_entry (list_pop_front (list), struct timer, elem));
+    }
+
+  {
+    int slot = wheel_base % WHEEL_SLOTS;
+    struct list *list = &wheel[0][slot];
+
+    wheel_used[0] &= ~(1ULL << slot);
+    while (!list_empty (list))
+      {
+        struct timer *t = list_entry (list_pop_front (list),
+                                      struct timer, elem);
+        list_push_back (t->expires <= now ? expired : later, &t->elem);
+      }
+  }
+  wheel_base++;
+}
+
+/* Expires the timers due at clock value NOW or earlier, calling
+   their functions.  Runs in the timer interrupt, with interrupts
+   off. */
+static void
+run_timers (int64_t now)
+{
+  uint64_t target = now >> WHEEL_UNIT_BITS;
+  struct list expired, later;
+
+  list_init (&expired);
+  list_init (&later);
+  while (wheel_base <= target)
+    {
+      uint64_t next = wheel_next ();
+      if (next > target)
+        {
+          wheel_base = target + 1;
+          break;
+        }
+      wheel_base = next;
+      wheel_step (&expired, &later, now);
+    }
+
+  /* Back into the wheel, now past their unit, so they are looked
+     at again in the next one. */
+  while (!list_empty (&later))
+    wheel_insert (list_entry (list_pop_front (&later), struct timer, elem));
+
+  /* A function may cancel a timer still on EXPIRED, which
+     removes it from the list. */
+  while (!list_empty (&expired))
+    {
+      struct timer *t = list_entry (list_pop_front (&expired),
+                                    struct timer, elem);
+      t->pending = false;
+      t->func (t);
+    }
+}
+
+/* Timer function that wakes up the thread sleeping on T. */
+static void
+wake_thread (struct timer *t)
+{
+  thread_unblock (t->aux);
+}
+
+/* Blocks the current thread until the clock reaches DEADLINE.
+   Interrupts must be turned on. */
+static void
+sleep_until (int64_t deadline)
+{
+  struct timer t;
+
+  ASSERT (intr_get_level () == INTR_ON);
+  timer_setup (&t, wake_thread, thread_current ());
+  intr_disable ();
+  timer_add (&t, deadline);
+  thread_block ();
+  intr_enable ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -234,7 +676,25 @@ real_time_sleep (int64_t num, int32_t denom)
   int64_t ticks = num * TIMER_FREQ / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
-  if (ticks > 0)
+  if (timer_tickless)
+    {
+      /* The PIT can interrupt at any cycle, so sleep for the
+         exact time, unless that is too short to be worth it. */
+      int64_t cycles = num * PIT_HZ / denom;
+
+      if (cycles >= ONESHOT_MIN)
+        {
+          int64_t deadline;
+
+          intr_disable ();
+          deadline = clock_now () + cycles;
+          intr_enable ();
+          sleep_until (deadline);
+        }
+      else
+        real_time_delay (num, denom);
+    }
+  else if (ticks > 0)
     {
       /* We're waiting for at least one full timer tick.  Use
          timer_sleep() because it will yield the CPU to other
@@ -249,6 +709,14 @@ real_time_sleep (int64_t num, int32_t denom)
     }
 }
 
+/* Converts COUNT cycles of an HZ Hz clock into nanoseconds,
+   without overflowing for large COUNT. */
+static int64_t
+to_ns (uint64_t count, uint64_t hz)
+{
+  return count / hz * NS_PER_SEC + count % hz * NS_PER_SEC / hz;
+}
+
 /* Busy-wait for approximately NUM/DENOM seconds. */
 static void
 real_time_delay (int64_t num, int32_t denom)
@@ -1,13 +1,19 @@
 #ifndef DEVICES_TIMER_H
 #define DEVICES_TIMER_H
 
+#include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include "stdbool.h"
+#include "devices/pit.h"
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* Use one-shot timer interrupts instead of periodic ones?
+   Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
 void timer_init (void);
 void timer_calibrate (void);
 
@@ -20,6 +26,30 @@ void timer_sleep (int64_t ticks);
 void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
+void timer_set_idle (bool);
+
+/* Clock ticks per second, for timer_clock() and timers. */
+#define TIMER_CLOCK_FREQ PIT_HZ
+
+int64_t timer_clock (void);
+int64_t timer_ns (void);
+
+/* A kernel timer, which calls a function at a given time. */
+struct timer;
+typedef void timer_func (struct timer *);
+
+struct timer
+  {
+    struct list_elem elem;              /* Element in the timer wheel. */
+    int64_t expires;                    /* timer_clock() value to expire at. */
+    timer_func *func;                   /* Called on expiry. */
+    void *aux;                          /* For FUNC. */
+    bool pending;                       /* Added, not yet expired or canceled? */
+  };
+
+void timer_setup (struct timer *, timer_func *, void *aux);
+void timer_add (struct timer *, int64_t expires);
+bool timer_cancel (struct timer *);
 
 /* Busy waits. */
 void timer_mdelay (int64_t milliseconds);
@@ -28,4 +58,14 @@ void timer_ndelay (int64_t nanoseconds);
 
 void timer_print_stats (void);
 
+/* Returns the CPU's time-stamp counter, which counts cycles, for
+   measuring short intervals. */
+static inline uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 #endif /* devices/timer.h */
@@ -9,7 +9,7 @@
 #include <stdint.h>
 #include <hash.h>
 
-static void cache_flush_slot (size_t slot_idx);
+static void cache_write_back (size_t slot_idx);
 static void cache_flush (void);
 
 
@@ -18,13 +18,21 @@ struct block_slot {
   uint8_t data[BLOCK_SECTOR_SIZE];
   bool accessed;
   bool dirty;
+  bool logged;                        /* Modified by the running journal transaction. */
+  block_sector_t owner;               /* Inode sector of the file whose data this is. */
+  bool delayed;                       /* No sector yet, SECTOR is an index in OWNER. */
   uint32_t user_count;
+  bool in_io;                         /* IO submitted and not reaped; holds a user_count. */
+  struct block_request io;            /* Read-ahead or writeback of this slot. */
 };
 
 struct block_slot *buffer_cache;
 struct bitmap *free_slots;
 
 struct lock cache_lock;
+static struct condition slot_released;  /* A slot may have become evictable. */
+
+static size_t delayed_reserved;       /* Slots promised to delayed sectors. */
 
 
 void cache_init (void) {
@@ -34,11 +42,16 @@ void cache_init (void) {
     buffer_cache[i].sector = -1;  /* At the beginning there must be no cache hits. */
     buffer_cache[i].accessed = false;
     buffer_cache[i].dirty = false;
+    buffer_cache[i].logged = false;
+    buffer_cache[i].owner = CACHE_NO_OWNER;
+    buffer_cache[i].delayed = false;
     buffer_cache[i].user_count = 0;
+    buffer_cache[i].in_io = false;
   }
   
   free_slots = bitmap_create(CACHE_CAPACITY);
   lock_init(&cache_lock);
+  cond_init(&slot_released);
 }
 
 void cache_destroy (void) {
@@ -53,22 +66,111 @@ void cache_destroy (void) {
 static int cache_find (block_sector_t sector) {
   int i = 0;
   for (; i < CACHE_CAPACITY; i++)
-    if (buffer_cache[i].sector == sector)
+    if (buffer_cache[i].sector == sector && !buffer_cache[i].delayed)
       return i;
   return -1;
 }
 
-static void cache_flush_slot (size_t slot_idx) {
-  block_write (fs_device, buffer_cache[slot_idx].sector, buffer_cache[slot_idx].data);
+static int cache_find_delayed (block_sector_t owner, block_sector_t index) {
+  int i = 0;
+  for (; i < CACHE_CAPACITY; i++)
+    if (buffer_cache[i].delayed && buffer_cache[i].owner == owner && buffer_cache[i].sector == index)
+      return i;
+  return -1;
+}
+
+/* Puts slot SLOT_IDX back on the free list, dropping its contents. */
+static void cache_free_slot (size_t slot_idx) {
+  buffer_cache[slot_idx].sector = -1;
+  buffer_cache[slot_idx].owner = CACHE_NO_OWNER;
+  buffer_cache[slot_idx].delayed = false;
   buffer_cache[slot_idx].dirty = false;
+  bitmap_reset (free_slots, slot_idx);
+  cond_broadcast (&slot_released, &cache_lock);
+}
+
+/* Drops a use of slot SLOT_IDX taken with CACHE_LOCK held. */
+static void cache_release (size_t slot_idx) {
+  lock_acquire(&cache_lock);
+  if (--buffer_cache[slot_idx].user_count == 0)
+    cond_broadcast (&slot_released, &cache_lock);
+  lock_release(&cache_lock);
+}
+
+/* Can slot SLOT_IDX be written back? */
+static bool cache_writable (int slot_idx) {
+  return buffer_cache[slot_idx].dirty && !buffer_cache[slot_idx].logged && !buffer_cache[slot_idx].delayed;
+}
+
+/* If the I/O submitted for slot SLOT_IDX has completed, forgets
+   it and drops the pin it held.  Returns true if the slot has no
+   I/O in flight. */
+static bool cache_reap (size_t slot_idx) {
+  if (buffer_cache[slot_idx].in_io && block_done (&buffer_cache[slot_idx].io)) {
+    buffer_cache[slot_idx].in_io = false;
+    buffer_cache[slot_idx].user_count--;
+  }
+  return !buffer_cache[slot_idx].in_io;
+}
+
+/* Waits for the I/O in flight on slot SLOT_IDX.  CACHE_LOCK is
+   released meanwhile, so the slot may hold another sector by the
+   time this returns. */
+static void cache_wait_io (size_t slot_idx) {
+  lock_release(&cache_lock);
+  block_wait (&buffer_cache[slot_idx].io);
+  lock_acquire(&cache_lock);
+  cache_reap (slot_idx);
+}
+
+/* Starts writing back slot SLOT_IDX, which must be writable and
+   have no I/O in flight, and returns without waiting.  The slot
+   is clean from now on; if it is written again before the
+   device is done, it just becomes dirty again. */
+static void cache_write_back (size_t slot_idx) {
+  ASSERT (!buffer_cache[slot_idx].in_io);
+  buffer_cache[slot_idx].dirty = false;
+  buffer_cache[slot_idx].in_io = true;
+  buffer_cache[slot_idx].user_count++;
+  block_request_init (&buffer_cache[slot_idx].io, true, buffer_cache[slot_idx].sector, 1, buffer_cache[slot_idx].data, NULL, NULL);
+  block_submit (fs_device, &buffer_cache[slot_idx].io);
+}
+
+/* Starts reading SECTOR into slot SLOT_IDX and returns without
+   waiting.  cache_lookup waits for the data when it is needed. */
+static void cache_read_ahead (size_t slot_idx, block_sector_t sector) {
+  buffer_cache[slot_idx].sector = sector;
+  buffer_cache[slot_idx].owner = CACHE_NO_OWNER;
+  buffer_cache[slot_idx].delayed = false;
+  buffer_cache[slot_idx].dirty = false;
+  buffer_cache[slot_idx].accessed = true;
+  buffer_cache[slot_idx].in_io = true;
+  buffer_cache[slot_idx].user_count++;
+  block_request_init (&buffer_cache[slot_idx].io, false, sector, 1, buffer_cache[slot_idx].data, NULL, NULL);
+  block_submit (fs_device, &buffer_cache[slot_idx].io);
+}
+
+/* Writes back every writable slot for which OWNER is CACHE_NO_OWNER
+   or matches the slot's owner, and waits until they are on disk.
+   Slots still being written from an earlier writeback get a
+   second round. */
+static void cache_write_back_all (block_sector_t owner) {
+  int round, i;
+  for (round = 0; round < 2; round++) {
+    for (i = 0; i < CACHE_CAPACITY; i++)
+      if ((owner == CACHE_NO_OWNER || buffer_cache[i].owner == owner) && cache_writable (i) && cache_reap (i))
+        cache_write_back (i);
+    for (i = 0; i < CACHE_CAPACITY; i++)
+      if (!cache_reap (i))
+        cache_wait_io (i);
+  }
 }
 
 static void cache_flush (void) {
   lock_acquire(&cache_lock);
+  cache_write_back_all (CACHE_NO_OWNER);
   int i = 0;
   for (; i < CACHE_CAPACITY; i++) {
-    if (buffer_cache[i].dirty)
-      cache_flush_slot (i);
     if (buffer_cache[i].accessed)
       buffer_cache[i].accessed = false;
     if (buffer_cache[i].user_count == 0)
@@ -77,58 +179,320 @@ static void cache_flush (void) {
   lock_release(&cache_lock);
 }
 
+/* Returns a slot to reuse, with no sector.  Dirty victims are
+   written back in the background and taken once clean; while
+   waiting for that, CACHE_LOCK may be released.  If every slot
+   is in use, logged or delayed, waits for one to be released:
+   spinning would keep the lock from whoever releases it. */
 static int cache_get_slot (void) {
   size_t i = bitmap_scan_and_flip(free_slots, 0, 1, false);
   if (i != BITMAP_ERROR) return i;
   while (true) {
+    int busy = -1;
+    bool evictable = false;
     i = 0;
     for (; i < CACHE_CAPACITY; i++) {
+      cache_reap (i);
+      bool candidate = buffer_cache[i].user_count == 0 && !buffer_cache[i].logged && !buffer_cache[i].delayed;
+      evictable |= candidate;
       if (buffer_cache[i].accessed)
         buffer_cache[i].accessed = false;
-      else if (buffer_cache[i].user_count == 0) { /* Evict */
-        if (buffer_cache[i].dirty)  /* Flush */
-          cache_flush_slot (i);
-        return i;
+      else if (candidate) { /* Evict */
+        if (!buffer_cache[i].dirty) {
+          buffer_cache[i].sector = -1;
+          bitmap_mark (free_slots, i);  /* Not on the free list either. */
+          return i;
+        }
+        cache_write_back (i);  /* Take it once clean. */
       }
+      if (buffer_cache[i].in_io)
+        busy = i;
     }
+    if (busy != -1)
+      cache_wait_io (busy);
+    else if (!evictable)
+      cond_wait (&slot_released, &cache_lock);
   }
 }
 
-static int cache_load (block_sector_t sector) {
-  int slot_idx = cache_get_slot ();
-  buffer_cache[slot_idx].sector = sector;
-  block_read (fs_device, sector, buffer_cache[slot_idx].data);
-  return slot_idx;
+/* Returns the slot holding SECTOR, reading it in on a miss, once
+   its data is there.  If MODIFY, also waits for a write-back in
+   flight, which the device is still reading the data from;
+   readers need not.  CACHE_LOCK must be held; it may be
+   released and reacquired meanwhile. */
+static int cache_lookup (block_sector_t sector, bool modify) {
+  while (true) {
+    int slot_idx = cache_find (sector);
+    if (slot_idx == -1) {
+      slot_idx = cache_get_slot ();
+      if (cache_find (sector) != -1) { /* Loaded by someone else meanwhile. */
+        cache_free_slot (slot_idx);
+        continue;
+      }
+      cache_read_ahead (slot_idx, sector);
+    }
+    if (cache_reap (slot_idx) || (!modify && buffer_cache[slot_idx].io.write))
+      return slot_idx;
+    cache_wait_io (slot_idx);
+  }
 }
 
 void cache_read (block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, void *buffer_) {
   uint8_t *buffer = buffer_;
 
   lock_acquire(&cache_lock);
-  int slot_idx = cache_find (sector);
-  if (slot_idx == -1) /* Cache miss */
-    slot_idx = cache_load (sector);
+  int slot_idx = cache_lookup (sector, false);
   buffer_cache[slot_idx].user_count++;
   lock_release(&cache_lock);
 
   memcpy (buffer + buffer_ofs, buffer_cache[slot_idx].data + sector_ofs, size);
   buffer_cache[slot_idx].accessed = true;
-  buffer_cache[slot_idx].user_count--;
+  cache_release (slot_idx);
 }
 
 
-void cache_write (block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer_) {
+static void cache_write_slot (block_sector_t owner, block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer_, bool logged) {
   const uint8_t *buffer = buffer_;
 
+  lock_acquire(&cache_lock);
+  int slot_idx = cache_lookup (sector, true);
+  buffer_cache[slot_idx].user_count++;
+  if (logged)
+    buffer_cache[slot_idx].logged = true;
+  buffer_cache[slot_idx].owner = owner;
+  lock_release(&cache_lock);
+
+  memcpy (buffer_cache[slot_idx].data + sector_ofs, buffer + buffer_ofs, size);
+  buffer_cache[slot_idx].accessed = true;
+  buffer_cache[slot_idx].dirty = true;
+  cache_release (slot_idx);
+}
+
+void cache_write (block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer) {
+  cache_write_slot (CACHE_NO_OWNER, sector, sector_ofs, buffer_ofs, size, buffer, false);
+}
+
+/* Same as cache_write, but remembers that the slot holds data of
+   the file whose inode is in sector OWNER, for cache_sync_owner. */
+void cache_write_owned (block_sector_t owner, block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer) {
+  cache_write_slot (owner, sector, sector_ofs, buffer_ofs, size, buffer, false);
+}
+
+/* Copies SIZE bytes from SRC at SRC_OFS to DST at DST_OFS, slot
+   to slot, without an intermediate buffer.  DST becomes data of
+   the file whose inode is in sector OWNER. */
+void cache_copy (block_sector_t owner, block_sector_t dst, int dst_ofs, block_sector_t src, int src_ofs, size_t size) {
+  lock_acquire(&cache_lock);
+  int src_idx = cache_lookup (src, false);
+  buffer_cache[src_idx].user_count++;
+  int dst_idx = cache_lookup (dst, true);
+  buffer_cache[dst_idx].user_count++;
+  buffer_cache[dst_idx].owner = owner;
+  lock_release(&cache_lock);
+
+  memmove (buffer_cache[dst_idx].data + dst_ofs, buffer_cache[src_idx].data + src_ofs, size);
+  buffer_cache[src_idx].accessed = true;
+  buffer_cache[dst_idx].accessed = true;
+  buffer_cache[dst_idx].dirty = true;
+  cache_release (src_idx);
+  cache_release (dst_idx);
+}
+
+
+/* Access pattern hints */
+
+/* Starts reading the CNT sectors starting at SECTOR into the
+   cache ahead of need, and returns without waiting for them.
+   The device queue merges the reads of adjacent sectors. */
+void cache_prefetch (block_sector_t sector, size_t cnt) {
+  size_t i;
+
+  lock_acquire(&cache_lock);
+  for (i = 0; i < cnt; i++) {
+    if (cache_find (sector + i) != -1)
+      continue;
+    int slot_idx = cache_get_slot ();
+    if (cache_find (sector + i) != -1)
+      cache_free_slot (slot_idx);
+    else
+      cache_read_ahead (slot_idx, sector + i);
+  }
+  lock_release(&cache_lock);
+}
+
+/* Tells the cache SECTOR will not be needed again soon.  Its
+   slot loses its second chance, so the clock takes it first.
+   The slot itself stays put: freeing it here could hand it out
+   twice, once from the free list and once by the clock. */
+void cache_demote (block_sector_t sector) {
   lock_acquire(&cache_lock);
   int slot_idx = cache_find (sector);
-  if (slot_idx == -1) /* Cache miss */
-    slot_idx = cache_load (sector);
+  if (slot_idx != -1)
+    buffer_cache[slot_idx].accessed = false;
+  lock_release(&cache_lock);
+}
+
+
+/* Durability */
+
+/* Writes back every dirty slot holding data of the file whose
+   inode is in sector OWNER.  Other files' slots are left alone. */
+void cache_sync_owner (block_sector_t owner) {
+  ASSERT (owner != CACHE_NO_OWNER);
+  lock_acquire(&cache_lock);
+  cache_write_back_all (owner);
+  lock_release(&cache_lock);
+}
+
+/* Writes back every dirty slot that is not part of the running
+   journal transaction and has a sector. */
+void cache_sync (void) {
+  lock_acquire(&cache_lock);
+  cache_write_back_all (CACHE_NO_OWNER);
+  lock_release(&cache_lock);
+}
+
+
+/* Journal support */
+
+/* Same as cache_write, but the slot is pinned in the cache and
+   never written back until cache_unlog is called for SECTOR.
+   Only the journal should call this. */
+void cache_write_logged (block_sector_t sector, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer) {
+  cache_write_slot (CACHE_NO_OWNER, sector, sector_ofs, buffer_ofs, size, buffer, true);
+}
+
+/* Allows SECTOR to be written back again, once it is committed. */
+void cache_unlog (block_sector_t sector) {
+  lock_acquire(&cache_lock);
+  int slot_idx = cache_find (sector);
+  ASSERT (slot_idx != -1);
+  buffer_cache[slot_idx].logged = false;
+  cond_broadcast (&slot_released, &cache_lock);
+  lock_release(&cache_lock);
+}
+
+/* Makes sure COMMITTED, the last committed contents of SECTOR,
+   or something newer has reached SECTOR on disk.
+   A slot that is not cached was written back when it was
+   evicted.  A slot that was logged again by the running
+   transaction must not be written back, so COMMITTED is
+   written instead. */
+void cache_checkpoint (block_sector_t sector, const void *committed) {
+  lock_acquire(&cache_lock);
+  int slot_idx;
+  while ((slot_idx = cache_find (sector)) != -1 && !buffer_cache[slot_idx].logged && !cache_reap (slot_idx))
+    cache_wait_io (slot_idx);
+  if (slot_idx != -1) {
+    if (buffer_cache[slot_idx].logged)
+      block_write (fs_device, sector, committed);
+    else if (buffer_cache[slot_idx].dirty) {
+      cache_write_back (slot_idx);
+      cache_wait_io (slot_idx);
+    }
+  }
+  lock_release(&cache_lock);
+}
+
+
+/* Delayed allocation */
+
+/* Reserves CNT slots for delayed sectors.  Returns false if that
+   would leave too few slots for everything else. */
+bool cache_reserve_delayed (size_t cnt) {
+  lock_acquire(&cache_lock);
+  bool success = delayed_reserved + cnt <= CACHE_DELAYED_MAX;
+  if (success)
+    delayed_reserved += cnt;
+  lock_release(&cache_lock);
+  return success;
+}
+
+/* Gives back CNT reserved slots that were never used. */
+void cache_unreserve_delayed (size_t cnt) {
+  lock_acquire(&cache_lock);
+  ASSERT (delayed_reserved >= cnt);
+  delayed_reserved -= cnt;
+  lock_release(&cache_lock);
+}
+
+/* Like cache_read, for the delayed sector INDEX of the file whose
+   inode is in sector OWNER.  The sector must have been written
+   with cache_write_delayed. */
+void cache_read_delayed (block_sector_t owner, block_sector_t index, int sector_ofs, off_t buffer_ofs, size_t size, void *buffer_) {
+  uint8_t *buffer = buffer_;
+
+  lock_acquire(&cache_lock);
+  int slot_idx = cache_find_delayed (owner, index);
+  ASSERT (slot_idx != -1);
+  buffer_cache[slot_idx].user_count++;
+  lock_release(&cache_lock);
+
+  memcpy (buffer + buffer_ofs, buffer_cache[slot_idx].data + sector_ofs, size);
+  buffer_cache[slot_idx].accessed = true;
+  cache_release (slot_idx);
+}
+
+/* Like cache_write, for the delayed sector INDEX of the file
+   whose inode is in sector OWNER.  The first write takes one of
+   the reserved slots and starts from zeros, without touching the
+   disk.  The slot stays in the cache until cache_assign or
+   cache_discard_delayed. */
+void cache_write_delayed (block_sector_t owner, block_sector_t index, int sector_ofs, off_t buffer_ofs, size_t size, const void *buffer_) {
+  const uint8_t *buffer = buffer_;
+
+  lock_acquire(&cache_lock);
+  int slot_idx = cache_find_delayed (owner, index);
+  if (slot_idx == -1) {
+    slot_idx = cache_get_slot ();
+    buffer_cache[slot_idx].sector = index;
+    buffer_cache[slot_idx].owner = owner;
+    buffer_cache[slot_idx].delayed = true;
+    memset (buffer_cache[slot_idx].data, 0, BLOCK_SECTOR_SIZE);
+  }
   buffer_cache[slot_idx].user_count++;
   lock_release(&cache_lock);
 
   memcpy (buffer_cache[slot_idx].data + sector_ofs, buffer + buffer_ofs, size);
   buffer_cache[slot_idx].accessed = true;
   buffer_cache[slot_idx].dirty = true;
-  buffer_cache[slot_idx].user_count--;
+  cache_release (slot_idx);
+}
+
+/* Gives the delayed sector INDEX of OWNER its freshly allocated
+   SECTOR.  The slot becomes an ordinary dirty slot.  A stale copy
+   of SECTOR left in the cache from its previous use takes the
+   data instead, so that SECTOR is never cached twice. */
+void cache_assign (block_sector_t owner, block_sector_t index, block_sector_t sector) {
+  lock_acquire(&cache_lock);
+  int stale_idx;
+  while ((stale_idx = cache_find (sector)) != -1 && !cache_reap (stale_idx))
+    cache_wait_io (stale_idx);  /* Its data is about to be overwritten. */
+  int slot_idx = cache_find_delayed (owner, index);
+  ASSERT (slot_idx != -1);
+  if (stale_idx != -1) {
+    memcpy (buffer_cache[stale_idx].data, buffer_cache[slot_idx].data, BLOCK_SECTOR_SIZE);
+    buffer_cache[stale_idx].owner = owner;
+    buffer_cache[stale_idx].dirty = true;
+    cache_free_slot (slot_idx);
+  } else {
+    buffer_cache[slot_idx].sector = sector;
+    buffer_cache[slot_idx].delayed = false;
+    cond_broadcast (&slot_released, &cache_lock);
+  }
+  delayed_reserved--;
+  lock_release(&cache_lock);
+}
+
+/* Drops every delayed sector of OWNER, for a file that is being
+   deleted, and gives back their reserved slots. */
+void cache_discard_delayed (block_sector_t owner) {
+  lock_acquire(&cache_lock);
+  int i = 0;
+  for (; i < CACHE_CAPACITY; i++)
+    if (buffer_cache[i].delayed && buffer_cache[i].owner == owner) {
+      cache_free_slot (i);
+      delayed_reserved--;
+    }
+  lock_release(&cache_lock);
 }
@@ -1,15 +1,37 @@
 #ifndef FILESYS_CACHE_H
 #define FILESYS_CACHE_H
 
+#include <stdbool.h>
 #include "devices/block.h"
 #include "filesys/off_t.h"
 
 #define CACHE_CAPACITY 64   /* Cache size in blocks */
+#define CACHE_NO_OWNER ((block_sector_t) -1)  /* Slot is not file data. */
+#define CACHE_DELAYED_MAX (CACHE_CAPACITY / 4)  /* Slots for delayed sectors. */
 
 void cache_init (void);
 void cache_destroy (void);
 
 void cache_read (block_sector_t, int, off_t, size_t, void*);
 void cache_write (block_sector_t, int, off_t, size_t, const void*);
+void cache_write_owned (block_sector_t, block_sector_t, int, off_t, size_t, const void*);
+void cache_copy (block_sector_t, block_sector_t, int, block_sector_t, int, size_t);
+
+void cache_prefetch (block_sector_t, size_t);
+void cache_demote (block_sector_t);
+
+void cache_sync_owner (block_sector_t);
+void cache_sync (void);
+
+bool cache_reserve_delayed (size_t);
+void cache_unreserve_delayed (size_t);
+void cache_read_delayed (block_sector_t, block_sector_t, int, off_t, size_t, void*);
+void cache_write_delayed (block_sector_t, block_sector_t, int, off_t, size_t, const void*);
+void cache_assign (block_sector_t, block_sector_t, block_sector_t);
+void cache_discard_delayed (block_sector_t);
+
+void cache_write_logged (block_sector_t, int, off_t, size_t, const void*);
+void cache_unlog (block_sector_t);
+void cache_checkpoint (block_sector_t, const void*);
 
 #endif
\ No newline at end of file
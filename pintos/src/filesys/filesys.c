@@ -6,6 +6,7 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/journal.h"
 #include "threads/thread.h"
 
 /* Partition that contains the file system. */
@@ -27,6 +28,7 @@ filesys_init (bool format)
   inode_init ();
   free_map_init ();
   cache_init();
+  journal_init (format);
 
   if (format)
     do_format ();
@@ -39,7 +41,9 @@ filesys_init (bool format)
 void
 filesys_done (void)
 {
+  inode_flush_all ();
   free_map_close ();
+  journal_done ();
   cache_destroy ();
 }
 
@@ -246,6 +250,16 @@ filesys_change_dir (const char* path) {
   return success;
 }
 
+/* Writes every dirty file's data to disk, then commits the
+   metadata journal. */
+void
+filesys_sync (void)
+{
+  inode_flush_all ();
+  cache_sync ();
+  journal_flush ();
+}
+
 int
 filesys_get_inode_number (const void *file) {
   return inode_get_inumber((const struct inode*)file);
@@ -7,6 +7,7 @@
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define JOURNAL_SECTOR 2        /* First sector of the metadata journal. */
 
 /* Block device that contains the file system. */
 struct block *fs_device;
@@ -17,6 +18,7 @@ bool filesys_create (const char *name, off_t initial_size, bool is_dir);
 void *filesys_open (const char *name, bool*);
 bool filesys_remove (const char *name);
 bool filesys_change_dir (const char *path);
+void filesys_sync (void);
 int filesys_get_inode_number (const void *file);
 
 #endif /* filesys/filesys.h */
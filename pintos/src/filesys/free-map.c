@@ -4,9 +4,13 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static size_t reserved_cnt;          /* Sectors promised to delayed allocations. */
+
+static size_t free_map_free_cnt (void);
 
 /* Initializes the free map. */
 void
@@ -17,6 +21,7 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,7 +32,12 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  block_sector_t sector;
+
+  if (reserved_cnt > 0 && free_map_free_cnt () < reserved_cnt + cnt)
+    return false;
+
+  sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
@@ -40,6 +50,33 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
   return sector != BITMAP_ERROR;
 }
 
+/* Returns the number of free sectors, reserved ones included. */
+static size_t
+free_map_free_cnt (void)
+{
+  return bitmap_count (free_map, 0, bitmap_size (free_map), false);
+}
+
+/* Sets aside CNT free sectors for a later free_map_allocate(),
+   which other allocations may not use.  Returns false if there
+   are not that many unreserved free sectors. */
+bool
+free_map_reserve (size_t cnt)
+{
+  if (free_map_free_cnt () < reserved_cnt + cnt)
+    return false;
+  reserved_cnt += cnt;
+  return true;
+}
+
+/* Gives back CNT sectors set aside by free_map_reserve(). */
+void
+free_map_unreserve (size_t cnt)
+{
+  ASSERT (reserved_cnt >= cnt);
+  reserved_cnt -= cnt;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
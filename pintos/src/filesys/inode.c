@@ -5,8 +5,11 @@
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
@@ -50,6 +53,10 @@ struct inode
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct lock lock;
     struct inode_disk data;             /* Inode content. */
+    block_sector_t delayed_cnt;         /* Sectors past END held in the cache only. */
+    size_t reserved;                    /* Free map sectors reserved for them. */
+    enum inode_advice advice;           /* ADVICE_NORMAL, _SEQUENTIAL or _RANDOM. */
+    block_sector_t ra_next;             /* First sector index not read ahead yet. */
   };
 
 
@@ -87,145 +94,475 @@ byte_to_sector (const struct inode *inode, off_t pos)
   return sector;
 }
 
+/* Returns true if INODE's contents are file system metadata,
+   that is, a directory or the free map, whose updates must be
+   journaled. */
+static bool
+inode_is_metadata (const struct inode *inode)
+{
+  return inode->data.is_dir || inode->sector == FREE_MAP_SECTOR;
+}
+
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Interval between background writebacks of delayed sectors. */
+#define FLUSH_INTERVAL_MS 5000
+
+static thread_func flush_thread;
+
 /* Initializes the inode module. */
 void
 inode_init (void)
 {
   list_init (&open_inodes);
   lock_init (&inodes_lock);
+  thread_create ("flushd", PRI_DEFAULT, flush_thread, NULL);
 }
 
-static void inode_destroy (struct inode_disk *disk_inode) {
-  block_sector_t index = 0;
-  block_sector_t *records = NULL;
+/* Largest number of data sectors an inode can address. */
+#define MAX_SECTORS (DIRECT_BLOCKS + RECORDS_IN_BLOCK + RECORDS_IN_BLOCK * RECORDS_IN_BLOCK)
+
+/* A run of consecutive sectors, used to allocate and release
+   data sectors a run at a time instead of one by one. */
+struct sector_run
+  {
+    block_sector_t start;               /* First sector. */
+    size_t cnt;                         /* Number of sectors. */
+  };
 
-  while (index < DIRECT_BLOCKS && index < disk_inode->end) {
-    free_map_release (disk_inode->direct[index], 1);
-    index++;
+/* Takes the next sector of RUN into *SECTOR.  If RUN is used up,
+   first allocates a new one of up to WANTED consecutive sectors,
+   settling for shorter runs if the free map is fragmented.
+   Returns false if the disk is full. */
+static bool run_next (struct sector_run *run, size_t wanted, block_sector_t *sector) {
+  if (run->cnt == 0) {
+    while (!free_map_allocate (wanted, &run->start)) {
+      if (wanted == 1) return false;
+      wanted /= 2;
+    }
+    run->cnt = wanted;
   }
-  if (index == disk_inode->end) return;
-
-  index -= DIRECT_BLOCKS;
-  records = malloc (BLOCK_SECTOR_SIZE);
-  cache_read (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  while (index < RECORDS_IN_BLOCK && index + DIRECT_BLOCKS < disk_inode->end) {
-    free_map_release (records[index], 1);
-    index++;
+  *sector = run->start++;
+  run->cnt--;
+  return true;
+}
+
+/* Adds SECTOR to RUN of sectors to release, releasing RUN first
+   if SECTOR does not extend it at either end. */
+static void run_release (struct sector_run *run, block_sector_t sector) {
+  if (run->cnt > 0 && sector + 1 == run->start) {
+    run->start--;
+    run->cnt++;
+  } else if (run->cnt > 0 && sector == run->start + run->cnt) {
+    run->cnt++;
+  } else {
+    if (run->cnt > 0)
+      free_map_release (run->start, run->cnt);
+    run->start = sector;
+    run->cnt = 1;
   }
-  free (records);
-  free_map_release (disk_inode->indirect, 1);
-  if (index + DIRECT_BLOCKS == disk_inode->end) return;
-
-  index -= RECORDS_IN_BLOCK;
-  records = malloc (BLOCK_SECTOR_SIZE);
-  cache_read (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  block_sector_t outer_index = index / RECORDS_IN_BLOCK;
-  block_sector_t inner_index = index % RECORDS_IN_BLOCK;
-  while (outer_index < RECORDS_IN_BLOCK) {
-    block_sector_t inner_records[RECORDS_IN_BLOCK];
-    cache_read (records[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner_records);
-    while (inner_index < RECORDS_IN_BLOCK
-          && inner_index + (outer_index + 1) * RECORDS_IN_BLOCK + DIRECT_BLOCKS < disk_inode->end) {
-            free_map_release (inner_records[inner_index], 1);
-            inner_index++;
-          }
-    free_map_release (records[outer_index], 1);
-    if (inner_index + (outer_index + 1) * RECORDS_IN_BLOCK + DIRECT_BLOCKS == disk_inode->end) {
-      free_map_release (disk_inode->doubly_indirect, 1);
-      free (records);
-      return;
+}
+
+/* Releases data sectors of DISK_INODE from the last one down to
+   NEW_END, along with index blocks that become empty.  Index
+   blocks are not rewritten, since entries past END are never
+   looked at. */
+static void inode_shrink (struct inode_disk *disk_inode, block_sector_t new_end) {
+  struct sector_run run = { 0, 0 };
+  block_sector_t *indirect = NULL, *dindirect = NULL, *inner = NULL;
+  block_sector_t inner_outer = 0;
+
+  while (disk_inode->end > new_end) {
+    block_sector_t index = disk_inode->end - 1;
+    if (index < DIRECT_BLOCKS) {
+      run_release (&run, disk_inode->direct[index]);
+    } else if (index < DIRECT_BLOCKS + RECORDS_IN_BLOCK) {
+      index -= DIRECT_BLOCKS;
+      if (indirect == NULL) {
+        indirect = malloc (BLOCK_SECTOR_SIZE);
+        if (indirect == NULL) PANIC ("inode_shrink: Kernel out of memory!");
+        cache_read (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, indirect);
+      }
+      run_release (&run, indirect[index]);
+      if (index == 0)
+        run_release (&run, disk_inode->indirect);
+    } else { /* Doubly Indirect */
+      index -= DIRECT_BLOCKS + RECORDS_IN_BLOCK;
+      block_sector_t outer_index = index / RECORDS_IN_BLOCK;
+      block_sector_t inner_index = index % RECORDS_IN_BLOCK;
+      if (dindirect == NULL) {
+        dindirect = malloc (BLOCK_SECTOR_SIZE);
+        inner = malloc (BLOCK_SECTOR_SIZE);
+        if (dindirect == NULL || inner == NULL) PANIC ("inode_shrink: Kernel out of memory!");
+        cache_read (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, dindirect);
+        inner_outer = outer_index + 1;  /* Force a load. */
+      }
+      if (inner_outer != outer_index) {
+        cache_read (dindirect[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner);
+        inner_outer = outer_index;
+      }
+      run_release (&run, inner[inner_index]);
+      if (inner_index == 0)
+        run_release (&run, dindirect[outer_index]);
+      if (index == 0)
+        run_release (&run, disk_inode->doubly_indirect);
     }
-    outer_index++;
-    inner_index %= RECORDS_IN_BLOCK;
+    disk_inode->end--;
   }
-  free_map_release (disk_inode->doubly_indirect, 1);
-  free (records);
+  if (run.cnt > 0)
+    free_map_release (run.start, run.cnt);
+  free (indirect);
+  free (dindirect);
+  free (inner);
+}
+
+/* Releases every sector of DISK_INODE's data. */
+static void inode_destroy (struct inode_disk *disk_inode) {
+  inode_shrink (disk_inode, 0);
 }
 
+/* Allocates SECTORS more data sectors for DISK_INODE, in runs of
+   consecutive sectors where the free map allows.  New sectors
+   are not zeroed: bytes past the end of file are undefined, and
+   whoever extends the file zeroes what it exposes (see
+   inode_extend()).  On failure DISK_INODE stays consistent with
+   the sectors allocated so far and false is returned. */
 static bool inode_grow (struct inode_disk *disk_inode, size_t sectors) {
-  static char zeros[BLOCK_SECTOR_SIZE];
+  struct sector_run run = { 0, 0 };
+  block_sector_t *indirect = NULL, *dindirect = NULL, *inner = NULL;
+  block_sector_t inner_outer = 0;
+  bool indirect_dirty = false, dindirect_dirty = false, inner_dirty = false;
+  bool success = true;
 
-  block_sector_t index = disk_inode->end;
-  block_sector_t *records = NULL;
+  for (; sectors > 0; sectors--) {
+    block_sector_t index = disk_inode->end;
+    block_sector_t data;
 
-  while (index < DIRECT_BLOCKS && sectors > 0) {
-    if (!free_map_allocate (1, &disk_inode->direct[index]))
-      return false;
-    cache_write (disk_inode->direct[index], 0, 0, BLOCK_SECTOR_SIZE, zeros);
-    disk_inode->end++;
-    index++;
-    sectors--;
-  }
-  if (sectors == 0) return true;
+    if (index >= MAX_SECTORS) {
+      success = false;
+      break;
+    }
 
-  if (index == DIRECT_BLOCKS) {
-    if (!free_map_allocate(1, &disk_inode->indirect)) return false;
-  }
-  index -= DIRECT_BLOCKS;
-
-  records = malloc (BLOCK_SECTOR_SIZE);
-  cache_read (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  while (index < RECORDS_IN_BLOCK && sectors > 0) {
-    if (!free_map_allocate (1, &records[index])) {
-      if (index == 0) free_map_release (disk_inode->indirect, 1);
-      else cache_write (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-      return false;
+    if (index < DIRECT_BLOCKS) {
+      if (!run_next (&run, sectors, &data)) {
+        success = false;
+        break;
+      }
+      disk_inode->direct[index] = data;
+    } else if (index < DIRECT_BLOCKS + RECORDS_IN_BLOCK) {
+      index -= DIRECT_BLOCKS;
+      if (indirect == NULL) {
+        indirect = calloc (1, BLOCK_SECTOR_SIZE);
+        if (indirect == NULL) PANIC ("inode_grow: Kernel out of memory!");
+        if (index != 0)
+          cache_read (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, indirect);
+      }
+      if (index == 0 && !free_map_allocate (1, &disk_inode->indirect)) {
+        success = false;
+        break;
+      }
+      if (!run_next (&run, sectors, &data)) {
+        if (index == 0) free_map_release (disk_inode->indirect, 1);
+        success = false;
+        break;
+      }
+      indirect[index] = data;
+      indirect_dirty = true;
+    } else { /* Doubly Indirect */
+      index -= DIRECT_BLOCKS + RECORDS_IN_BLOCK;
+      block_sector_t outer_index = index / RECORDS_IN_BLOCK;
+      block_sector_t inner_index = index % RECORDS_IN_BLOCK;
+      if (dindirect == NULL) {
+        dindirect = calloc (1, BLOCK_SECTOR_SIZE);
+        inner = calloc (1, BLOCK_SECTOR_SIZE);
+        if (dindirect == NULL || inner == NULL) PANIC ("inode_grow: Kernel out of memory!");
+        if (index != 0)
+          cache_read (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, dindirect);
+        inner_outer = outer_index;
+        if (inner_index != 0)
+          cache_read (dindirect[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner);
+      }
+      if (inner_outer != outer_index) { /* Moved on to a new inner block. */
+        if (inner_dirty)
+          journal_write (dindirect[inner_outer], 0, 0, BLOCK_SECTOR_SIZE, inner);
+        inner_dirty = false;
+        inner_outer = outer_index;
+      }
+      if (index == 0 && !free_map_allocate (1, &disk_inode->doubly_indirect)) {
+        success = false;
+        break;
+      }
+      if (inner_index == 0 && !free_map_allocate (1, &dindirect[outer_index])) {
+        if (index == 0) free_map_release (disk_inode->doubly_indirect, 1);
+        success = false;
+        break;
+      }
+      if (!run_next (&run, sectors, &data)) {
+        if (inner_index == 0) free_map_release (dindirect[outer_index], 1);
+        if (index == 0) free_map_release (disk_inode->doubly_indirect, 1);
+        success = false;
+        break;
+      }
+      if (inner_index == 0) {
+        memset (inner, 0, BLOCK_SECTOR_SIZE);
+        dindirect_dirty = true;
+      }
+      inner[inner_index] = data;
+      inner_dirty = true;
     }
-    cache_write (records[index], 0, 0, BLOCK_SECTOR_SIZE, zeros);
     disk_inode->end++;
-    index++;
-    sectors--;
   }
-  cache_write (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  free (records);
-  if (sectors == 0) return true;
 
+  if (indirect_dirty)
+    journal_write (disk_inode->indirect, 0, 0, BLOCK_SECTOR_SIZE, indirect);
+  if (inner_dirty)
+    journal_write (dindirect[inner_outer], 0, 0, BLOCK_SECTOR_SIZE, inner);
+  if (dindirect_dirty)
+    journal_write (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, dindirect);
+  if (run.cnt > 0)
+    free_map_release (run.start, run.cnt);
+  free (indirect);
+  free (dindirect);
+  free (inner);
+  return success;
+}
+
+/* Zeroes bytes FROM through TO - 1 of DISK_INODE, which is
+   stored in sector OWNER and must already have sectors for
+   them.  Directory contents are metadata, so they go through
+   the journal. */
+static void zero_range (block_sector_t owner, const struct inode_disk *disk_inode, off_t from, off_t to) {
+  static char zeros[BLOCK_SECTOR_SIZE];
 
-  if (index == RECORDS_IN_BLOCK) { 
-    if (!free_map_allocate(1, &disk_inode->doubly_indirect)) return false;
+  while (from < to) {
+    block_sector_t sector = get_disk_sector (disk_inode, from / BLOCK_SECTOR_SIZE);
+    int sector_ofs = from % BLOCK_SECTOR_SIZE;
+    int chunk_size = BLOCK_SECTOR_SIZE - sector_ofs;
+    if (chunk_size > to - from)
+      chunk_size = to - from;
+
+    if (disk_inode->is_dir)
+      journal_write (sector, sector_ofs, 0, chunk_size, zeros);
+    else
+      cache_write_owned (owner, sector, sector_ofs, 0, chunk_size, zeros);
+    from += chunk_size;
   }
-  index -= RECORDS_IN_BLOCK;
-
-  records = malloc (BLOCK_SECTOR_SIZE);
-  cache_read (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  block_sector_t outer_index = index / RECORDS_IN_BLOCK;
-  block_sector_t inner_index = index % RECORDS_IN_BLOCK;
-  while (outer_index < RECORDS_IN_BLOCK && sectors > 0) {
-    if (inner_index == 0 && !free_map_allocate (1, &records[outer_index])) {
-      if (outer_index == 0) free_map_release (disk_inode->doubly_indirect, 1);
-      else cache_write (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
+}
+
+/* Delayed allocation.
+
+   A write that extends a regular file past its allocated sectors
+   does not allocate.  The new sectors are only reserved, in the
+   free map and in the buffer cache, and their data is kept in
+   "delayed" cache slots keyed by inode and sector index.  Real
+   sectors are chosen when the delayed sectors are written back
+   (inode_flush_delayed()): on close, fsync, sync, truncation,
+   when the cache runs short of delayed slots, and periodically.
+   By then the whole extent is known and can be allocated as one
+   run.  The on-disk inode never counts delayed sectors. */
+
+/* Free map sectors to reserve for CNT delayed sectors: the data
+   plus every index block they might need. */
+static size_t
+delayed_reservation (size_t cnt)
+{
+  return cnt == 0 ? 0 : cnt + cnt / RECORDS_IN_BLOCK + 3;
+}
+
+/* Writes INODE's on-disk inode, whose length covers only the
+   allocated sectors. */
+static void
+inode_write_disk (struct inode *inode)
+{
+  struct inode_disk disk_inode = inode->data;
+  off_t allocated = inode->data.end * BLOCK_SECTOR_SIZE;
+
+  if (disk_inode.length > allocated)
+    disk_inode.length = allocated;
+  journal_write (inode->sector, 0, 0, BLOCK_SECTOR_SIZE, &disk_inode);
+}
+
+/* Allocates INODE's delayed sectors in one go and writes them
+   back, data first, then the inode that points to them.
+   INODE's lock must be held. */
+static void
+inode_flush_delayed (struct inode *inode)
+{
+  block_sector_t index = inode->data.end;
+
+  if (inode->delayed_cnt == 0)
+    return;
+
+  free_map_unreserve (inode->reserved);
+  inode->reserved = 0;
+  inode_grow (&inode->data, inode->delayed_cnt);
+  for (; index < inode->data.end; index++)
+    cache_assign (inode->sector, index, get_disk_sector (&inode->data, index));
+
+  /* Only possible if the disk filled up behind the reservation's
+     back: the data that did not get sectors is lost. */
+  if (inode->data.length > (off_t) inode->data.end * BLOCK_SECTOR_SIZE)
+    {
+      cache_discard_delayed (inode->sector);
+      inode->data.length = inode->data.end * BLOCK_SECTOR_SIZE;
+    }
+  inode->delayed_cnt = 0;
+
+  cache_sync_owner (inode->sector);
+  inode_write_disk (inode);
+}
+
+/* Drops INODE's delayed sectors without writing them, for an
+   inode that is being deleted. */
+static void
+inode_discard_delayed (struct inode *inode)
+{
+  if (inode->delayed_cnt == 0)
+    return;
+  cache_discard_delayed (inode->sector);
+  free_map_unreserve (inode->reserved);
+  inode->reserved = 0;
+  inode->delayed_cnt = 0;
+}
+
+/* Tries to make INODE's sectors up to SECTORS delayed instead of
+   allocating them.  If the cache has no room left, INODE's own
+   delayed sectors are written back first to make some.  Returns
+   false if delaying is not possible.  INODE's lock must be
+   held. */
+static bool
+inode_delay (struct inode *inode, size_t sectors)
+{
+  size_t extra, cnt, reservation;
+
+  if (inode_is_metadata (inode) || sectors > MAX_SECTORS)
+    return false;
+
+  extra = sectors - inode->data.end - inode->delayed_cnt;
+  if (!cache_reserve_delayed (extra))
+    {
+      inode_flush_delayed (inode);
+      extra = sectors - inode->data.end;
+      if (!cache_reserve_delayed (extra))
+        return false;
+    }
+
+  cnt = inode->delayed_cnt + extra;
+  reservation = delayed_reservation (cnt);
+  if (!free_map_reserve (reservation - inode->reserved))
+    {
+      cache_unreserve_delayed (extra);
       return false;
     }
-    block_sector_t inner_records[RECORDS_IN_BLOCK];
-    cache_read (records[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner_records);
-    while (inner_index < RECORDS_IN_BLOCK && sectors > 0) {
-      if (!free_map_allocate (1, &inner_records[inner_index])) {
-        if (inner_index == 0) {
-          free_map_release (records[outer_index], 1);
-          if (outer_index == 0) free_map_release (disk_inode->doubly_indirect, 1);
-          else cache_write (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
+  inode->reserved = reservation;
+  inode->delayed_cnt = cnt;
+  return true;
+}
+
+/* Reads SIZE bytes at SECTOR_OFS in data sector INDEX of INODE
+   into BUFFER + BUFFER_OFS, whether the sector is allocated yet
+   or not. */
+static void
+read_sector (const struct inode *inode, block_sector_t index, int sector_ofs,
+             off_t buffer_ofs, size_t size, void *buffer)
+{
+  if (index >= inode->data.end)
+    cache_read_delayed (inode->sector, index, sector_ofs, buffer_ofs, size, buffer);
+  else
+    cache_read (get_disk_sector (&inode->data, index), sector_ofs,
+                buffer_ofs, size, buffer);
+}
+
+/* Writes SIZE bytes from BUFFER + BUFFER_OFS at SECTOR_OFS in
+   data sector INDEX of INODE, whether the sector is allocated yet
+   or not.  Directory contents go through the journal. */
+static void
+write_sector (struct inode *inode, block_sector_t index, int sector_ofs,
+              off_t buffer_ofs, size_t size, const void *buffer)
+{
+  if (index >= inode->data.end)
+    cache_write_delayed (inode->sector, index, sector_ofs, buffer_ofs, size, buffer);
+  else if (inode_is_metadata (inode))
+    journal_write (get_disk_sector (&inode->data, index), sector_ofs,
+                   buffer_ofs, size, buffer);
+  else
+    cache_write_owned (inode->sector, get_disk_sector (&inode->data, index),
+                       sector_ofs, buffer_ofs, size, buffer);
+}
+
+/* Makes INODE at least NEW_SIZE bytes long for a write that
+   starts at WRITE_OFS, zeroing the gap between the old end of
+   file and WRITE_OFS.  New sectors are delayed if DELAY is true
+   and that is possible, otherwise allocated right away.  INODE's
+   lock must be held.  Returns false if the disk is full, in
+   which case INODE's length is unchanged. */
+static bool
+inode_extend (struct inode *inode, off_t new_size, off_t write_ofs, bool delay)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  size_t sectors = bytes_to_sectors (new_size);
+  off_t ofs;
+
+  if (new_size <= inode->data.length)
+    return true;
+
+  if (sectors > inode->data.end + inode->delayed_cnt
+      && !(delay && inode_delay (inode, sectors)))
+    {
+      inode_flush_delayed (inode);
+      if (sectors > inode->data.end
+          && !inode_grow (&inode->data, sectors - inode->data.end))
+        {
+          inode_write_disk (inode);
+          return false;
         }
-        else cache_write (records[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner_records);
+    }
 
-        return false;
-      }
-      cache_write (inner_records[inner_index], 0, 0, BLOCK_SECTOR_SIZE, zeros);
-      disk_inode->end++;
-      inner_index++;
-      sectors--;
+  for (ofs = inode->data.length; ofs < write_ofs; )
+    {
+      int sector_ofs = ofs % BLOCK_SECTOR_SIZE;
+      int chunk_size = BLOCK_SECTOR_SIZE - sector_ofs;
+      if (chunk_size > write_ofs - ofs)
+        chunk_size = write_ofs - ofs;
+      write_sector (inode, ofs / BLOCK_SECTOR_SIZE, sector_ofs, 0,
+                    chunk_size, zeros);
+      ofs += chunk_size;
+    }
+  inode->data.length = new_size;
+  inode_write_disk (inode);
+  return true;
+}
+
+/* Writes back the delayed sectors of every open inode. */
+void
+inode_flush_all (void)
+{
+  struct list_elem *e;
+
+  lock_acquire (&inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      lock_acquire (&inode->lock);
+      inode_flush_delayed (inode);
+      lock_release (&inode->lock);
+    }
+  lock_release (&inodes_lock);
+}
+
+/* Background thread: bounds how long data may stay in delayed
+   sectors. */
+static void
+flush_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (FLUSH_INTERVAL_MS);
+      inode_flush_all ();
     }
-    cache_write (records[outer_index], 0, 0, BLOCK_SECTOR_SIZE, inner_records);
-    outer_index++;
-    inner_index %= RECORDS_IN_BLOCK;
-  }
-  cache_write (disk_inode->doubly_indirect, 0, 0, BLOCK_SECTOR_SIZE, records);
-  free (records);
-  if (sectors == 0) return true;
-  return false;
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -257,7 +594,8 @@ inode_create (block_sector_t sector, off_t length, bool is_dir)
       if (!inode_grow(disk_inode, sectors)) {
         inode_destroy (disk_inode);
       } else {
-        cache_write (sector, 0, 0, BLOCK_SECTOR_SIZE, disk_inode);
+        zero_range (sector, disk_inode, 0, length);
+        journal_write (sector, 0, 0, BLOCK_SECTOR_SIZE, disk_inode);
         success = true;
       }
       free (disk_inode);
@@ -302,6 +640,10 @@ inode_open (block_sector_t sector)
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->delayed_cnt = 0;
+  inode->reserved = 0;
+  inode->advice = ADVICE_NORMAL;
+  inode->ra_next = 0;
   lock_init (&inode->lock);
   cache_read (inode->sector, 0, 0, BLOCK_SECTOR_SIZE, &inode->data);
   lock_release (&inodes_lock);
@@ -345,12 +687,20 @@ inode_close (struct inode *inode)
       list_remove (&inode->elem);
       lock_release (&inodes_lock);
 
-      /* Deallocate blocks if removed. */
+      /* Deallocate blocks if removed, otherwise write back
+         delayed sectors. */
       if (inode->removed)
         {
+          inode_discard_delayed (inode);
           free_map_release (inode->sector, 1);
           inode_destroy (&inode->data);
         }
+      else if (inode->delayed_cnt > 0)
+        {
+          lock_acquire (&inode->lock);
+          inode_flush_delayed (inode);
+          lock_release (&inode->lock);
+        }
       free (inode);
     } else
     lock_release (&inodes_lock);
@@ -365,6 +715,49 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Sectors read ahead of a sequential reader. */
+#define READ_AHEAD_SECTORS 16
+
+/* Prefetches allocated sectors of INODE from index FROM to FROM +
+   CNT - 1, one cache_prefetch() per run of contiguous disk
+   sectors. */
+static void
+prefetch (struct inode *inode, block_sector_t from, block_sector_t cnt)
+{
+  block_sector_t index, run_start = 0, run_cnt = 0;
+
+  for (index = from; index < from + cnt && index < inode->data.end; index++)
+    {
+      block_sector_t sector = get_disk_sector (&inode->data, index);
+      if (run_cnt > 0 && sector == run_start + run_cnt)
+        run_cnt++;
+      else
+        {
+          if (run_cnt > 0)
+            cache_prefetch (run_start, run_cnt);
+          run_start = sector;
+          run_cnt = 1;
+        }
+    }
+  if (run_cnt > 0)
+    cache_prefetch (run_start, run_cnt);
+}
+
+/* Keeps the read-ahead window READ_AHEAD_SECTORS sectors ahead
+   of a sequential reader positioned at sector index NEXT,
+   reading only sectors that were not read ahead before. */
+static void
+read_ahead (struct inode *inode, block_sector_t next)
+{
+  block_sector_t from = inode->ra_next > next ? inode->ra_next : next;
+  block_sector_t to = next + READ_AHEAD_SECTORS;
+
+  if (from >= to)
+    return;
+  prefetch (inode, from, to - from);
+  inode->ra_next = to;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -378,8 +771,7 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 
   while (size > 0)
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector. */
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -392,13 +784,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      cache_read (sector_idx, sector_ofs, bytes_read, chunk_size, buffer);
+      read_sector (inode, offset / BLOCK_SECTOR_SIZE, sector_ofs,
+                   bytes_read, chunk_size, buffer);
+
+      /* A sequential reader is done with a sector once it reads
+         its last byte: let it go first. */
+      if (inode->advice == ADVICE_SEQUENTIAL
+          && sector_ofs + chunk_size == BLOCK_SECTOR_SIZE
+          && (block_sector_t) (offset / BLOCK_SECTOR_SIZE) < inode->data.end)
+        cache_demote (byte_to_sector (inode, offset));
 
       /* Advance. */
       size -= chunk_size;
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  if (inode->advice == ADVICE_SEQUENTIAL && bytes_read > 0)
+    read_ahead (inode, offset / BLOCK_SECTOR_SIZE);
   lock_release (&inode->lock);
   return bytes_read;
 }
@@ -422,19 +824,11 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
     return 0;
   }
 
-  off_t new_size = offset + size;
-  if (new_size > inode->data.length) {
-    size_t needed_sectors = DIV_ROUND_UP(new_size, BLOCK_SECTOR_SIZE) - inode->data.end;
-    if (inode_grow(&inode->data, needed_sectors)) {
-      inode->data.length = new_size;
-      cache_write (inode->sector, 0, 0, BLOCK_SECTOR_SIZE, &inode->data);
-    }
-  }
+  inode_extend (inode, offset + size, offset, true);
 
   while (size > 0)
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector. */
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -447,7 +841,8 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
-      cache_write (sector_idx, sector_ofs, bytes_written, chunk_size, buffer);
+      write_sector (inode, offset / BLOCK_SECTOR_SIZE, sector_ofs,
+                    bytes_written, chunk_size, buffer);
 
       /* Advance. */
       size -= chunk_size;
@@ -458,6 +853,209 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   return bytes_written;
 }
 
+/* Acquires the locks of A and B, which may be the same inode,
+   in sector order so that two copies in opposite directions
+   cannot deadlock. */
+static void
+inode_lock_pair (struct inode *a, struct inode *b)
+{
+  if (a == b)
+    lock_acquire (&a->lock);
+  else if (a->sector < b->sector)
+    {
+      lock_acquire (&a->lock);
+      lock_acquire (&b->lock);
+    }
+  else
+    {
+      lock_acquire (&b->lock);
+      lock_acquire (&a->lock);
+    }
+}
+
+/* Releases the locks acquired by inode_lock_pair(). */
+static void
+inode_unlock_pair (struct inode *a, struct inode *b)
+{
+  lock_release (&a->lock);
+  if (a != b)
+    lock_release (&b->lock);
+}
+
+/* Copies SIZE bytes from SRC, starting at SRC_OFS, into DST,
+   starting at DST_OFS, growing DST if necessary.  Data moves
+   directly between buffer cache slots, one memcpy per sector.
+   Returns the number of bytes actually copied, which may be
+   less than SIZE if end of SRC is reached or an error occurs,
+   or -1 if DST and SRC are the same inode and the two ranges
+   overlap.  Neither inode may be a directory. */
+off_t
+inode_copy_at (struct inode *dst, off_t dst_ofs,
+               struct inode *src, off_t src_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+
+  ASSERT (!inode_is_metadata (dst));
+
+  inode_lock_pair (dst, src);
+
+  if (dst->deny_write_cnt || src_ofs >= inode_length (src))
+    {
+      inode_unlock_pair (dst, src);
+      return 0;
+    }
+
+  if (size > inode_length (src) - src_ofs)
+    size = inode_length (src) - src_ofs;
+
+  /* Copying forward would read bytes it already overwrote. */
+  if (dst == src && src_ofs < dst_ofs + size && dst_ofs < src_ofs + size)
+    {
+      inode_unlock_pair (dst, src);
+      return -1;
+    }
+
+  /* Slot to slot copies need real sectors on both sides. */
+  inode_flush_delayed (src);
+  inode_flush_delayed (dst);
+  inode_extend (dst, dst_ofs + size, dst_ofs, false);
+
+  while (size > 0)
+    {
+      /* Starting byte offsets within sectors. */
+      int src_sector_ofs = src_ofs % BLOCK_SECTOR_SIZE;
+      int dst_sector_ofs = dst_ofs % BLOCK_SECTOR_SIZE;
+
+      /* Bytes left in DST, bytes left in either sector, least of
+         them all. */
+      off_t inode_left = inode_length (dst) - dst_ofs;
+      int src_left = BLOCK_SECTOR_SIZE - src_sector_ofs;
+      int dst_left = BLOCK_SECTOR_SIZE - dst_sector_ofs;
+      int min_left = src_left < dst_left ? src_left : dst_left;
+      if (inode_left < min_left)
+        min_left = inode_left;
+
+      /* Number of bytes to actually copy between these sectors. */
+      int chunk_size = size < min_left ? size : min_left;
+      if (chunk_size <= 0)
+        break;
+
+      cache_copy (dst->sector, byte_to_sector (dst, dst_ofs), dst_sector_ofs,
+                  byte_to_sector (src, src_ofs), src_sector_ofs, chunk_size);
+
+      /* Advance. */
+      size -= chunk_size;
+      src_ofs += chunk_size;
+      dst_ofs += chunk_size;
+      bytes_copied += chunk_size;
+    }
+  inode_unlock_pair (dst, src);
+  return bytes_copied;
+}
+
+/* Reserves sectors for bytes OFFSET through OFFSET + LEN - 1 of
+   INODE without changing its length or writing the sectors, so
+   that later writes there need no allocation.  Sectors are taken
+   in consecutive runs where possible.  Returns false if the disk
+   is full; sectors reserved until then are kept. */
+bool
+inode_allocate (struct inode *inode, off_t offset, off_t len)
+{
+  size_t sectors = bytes_to_sectors (offset + len);
+  bool success = true;
+
+  lock_acquire (&inode->lock);
+  inode_flush_delayed (inode);
+  if (sectors > inode->data.end)
+    {
+      success = inode_grow (&inode->data, sectors - inode->data.end);
+      inode_write_disk (inode);
+    }
+  lock_release (&inode->lock);
+  return success;
+}
+
+/* Sets INODE's length to LENGTH.  Shrinking releases every
+   sector past the new end of file, reserved ones included, from
+   the tail down.  Growing zeroes the new bytes.  Returns false
+   if the disk is full. */
+bool
+inode_truncate (struct inode *inode, off_t length)
+{
+  bool success = true;
+
+  lock_acquire (&inode->lock);
+  if (inode->deny_write_cnt)
+    success = false;
+  else if (length > inode->data.length)
+    success = inode_extend (inode, length, length, true);
+  else
+    {
+      inode_flush_delayed (inode);
+      inode->data.length = length;
+      inode_shrink (&inode->data, bytes_to_sectors (length));
+      inode_write_disk (inode);
+    }
+  lock_release (&inode->lock);
+  return success;
+}
+
+/* Applies access pattern ADVICE to bytes OFFSET through
+   OFFSET + LEN - 1 of INODE, or to the rest of the file if LEN
+   is 0.  SEQUENTIAL, RANDOM and NORMAL set the read-ahead
+   behavior of the whole inode; WILLNEED reads the range into the
+   cache, at most half of it; DONTNEED writes it back and lets
+   its slots go before any others. */
+void
+inode_advise (struct inode *inode, off_t offset, off_t len,
+              enum inode_advice advice)
+{
+  block_sector_t first = offset / BLOCK_SECTOR_SIZE;
+  block_sector_t end, index;
+
+  lock_acquire (&inode->lock);
+  end = len == 0 ? inode->data.end : bytes_to_sectors (offset + len);
+  if (end > inode->data.end)
+    end = inode->data.end;
+
+  switch (advice)
+    {
+    case ADVICE_NORMAL:
+    case ADVICE_SEQUENTIAL:
+    case ADVICE_RANDOM:
+      inode->advice = advice;
+      inode->ra_next = 0;
+      break;
+
+    case ADVICE_WILLNEED:
+      if (first < end)
+        prefetch (inode, first, end - first < CACHE_CAPACITY / 2
+                                ? end - first : CACHE_CAPACITY / 2);
+      break;
+
+    case ADVICE_DONTNEED:
+      cache_sync_owner (inode->sector);
+      for (index = first; index < end; index++)
+        cache_demote (get_disk_sector (&inode->data, index));
+      break;
+    }
+  lock_release (&inode->lock);
+}
+
+/* Makes INODE's contents durable.  Writes back INODE's own data
+   sectors first, then commits the journal, which holds its inode
+   sector and indirect blocks, so that committed metadata never
+   points to data that did not reach the disk. */
+void
+inode_sync (struct inode *inode)
+{
+  lock_acquire (&inode->lock);
+  inode_flush_delayed (inode);
+  cache_sync_owner (inode->sector);
+  lock_release (&inode->lock);
+  journal_flush ();
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -8,6 +8,17 @@
 
 struct bitmap;
 
+/* Access pattern advice for inode_advise().  Values match the
+   FADV_* constants of the fadvise() system call. */
+enum inode_advice
+  {
+    ADVICE_NORMAL,              /* No particular pattern. */
+    ADVICE_SEQUENTIAL,          /* Read once, front to back. */
+    ADVICE_RANDOM,              /* No locality, don't read ahead. */
+    ADVICE_WILLNEED,            /* Range will be needed soon. */
+    ADVICE_DONTNEED             /* Range won't be needed again. */
+  };
+
 void inode_init (void);
 bool inode_create (block_sector_t, off_t, bool);
 struct inode *inode_open (block_sector_t);
@@ -17,6 +28,14 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_copy_at (struct inode *dst, off_t dst_ofs,
+                     struct inode *src, off_t src_ofs, off_t size);
+bool inode_allocate (struct inode *, off_t offset, off_t len);
+bool inode_truncate (struct inode *, off_t length);
+void inode_advise (struct inode *, off_t offset, off_t len,
+                   enum inode_advice);
+void inode_sync (struct inode *);
+void inode_flush_all (void);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
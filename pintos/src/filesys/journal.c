@@ -0,0 +1,292 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "devices/timer.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Log records reserved by each operation in journal_begin().
+   Enough for an inode, the free map and a couple of indirect
+   blocks.  An operation that needs more still succeeds, but
+   may force an early commit (see journal_write()). */
+#define JOURNAL_OP_RESERVE 8
+
+/* Interval between background commits and checkpoints. */
+#define JOURNAL_INTERVAL_MS 1000
+
+/* On-disk journal header, stored in JOURNAL_SECTOR.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* Magic number. */
+    uint32_t cnt;                       /* Committed records, 0 if clean. */
+    block_sector_t home[JOURNAL_CAPACITY];  /* Home sector of each record. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 8 - 4 * JOURNAL_CAPACITY];
+  };
+
+static struct lock journal_lock;
+static struct condition journal_changed;  /* Signaled after commits and ends. */
+static bool enabled;
+
+/* Running transaction. */
+static int outstanding;                 /* Operations in progress. */
+static int waiters;                     /* Threads waiting for a commit. */
+static unsigned commit_seq;             /* Number of commits so far. */
+static block_sector_t logged[JOURNAL_CAPACITY];
+static size_t logged_cnt;
+
+/* Last committed transaction, not yet checkpointed. */
+static block_sector_t *ckpt_home;
+static uint8_t *ckpt_data;
+static size_t ckpt_cnt;
+
+static struct journal_header *header;
+
+static thread_func journal_thread;
+static void replay (void);
+static void commit (void);
+static void checkpoint (void);
+
+/* Initializes the journal.  Replays the log left by an unclean
+   shutdown, unless FORMAT is true, in which case the log is
+   simply reset. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof *header == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&journal_changed);
+
+  header = malloc (sizeof *header);
+  ckpt_home = malloc (JOURNAL_CAPACITY * sizeof *ckpt_home);
+  ckpt_data = malloc (JOURNAL_CAPACITY * BLOCK_SECTOR_SIZE);
+  if (header == NULL || ckpt_home == NULL || ckpt_data == NULL)
+    PANIC ("journal_init: Kernel out of memory!");
+
+  if (!format)
+    replay ();
+
+  memset (header, 0, sizeof *header);
+  header->magic = JOURNAL_MAGIC;
+  block_write (fs_device, JOURNAL_SECTOR, header);
+
+  enabled = true;
+  thread_create ("journald", PRI_DEFAULT, journal_thread, NULL);
+}
+
+/* Commits and checkpoints everything, leaving a clean log. */
+void
+journal_done (void)
+{
+  journal_flush ();
+  lock_acquire (&journal_lock);
+  checkpoint ();
+  enabled = false;
+  lock_release (&journal_lock);
+}
+
+/* Starts an operation in the running transaction on behalf of
+   the current thread, waiting for log space if necessary.  Must
+   not be called with file system locks held. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+  ASSERT (!t->journal_op);
+
+  lock_acquire (&journal_lock);
+  while (logged_cnt + (outstanding + 1) * JOURNAL_OP_RESERVE > JOURNAL_CAPACITY)
+    {
+      if (outstanding == 0)
+        commit ();
+      else
+        {
+          waiters++;
+          cond_wait (&journal_changed, &journal_lock);
+          waiters--;
+        }
+    }
+  outstanding++;
+  t->journal_op = true;
+  lock_release (&journal_lock);
+}
+
+/* Ends the current thread's operation.  The last operation to
+   end commits the transaction if some thread is waiting for it,
+   otherwise it is left to group with later operations. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+  ASSERT (t->journal_op);
+
+  lock_acquire (&journal_lock);
+  t->journal_op = false;
+  if (--outstanding == 0 && waiters > 0 && logged_cnt > 0)
+    commit ();
+  cond_broadcast (&journal_changed, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Waits until every metadata update made so far is committed to
+   the log. */
+void
+journal_flush (void)
+{
+  unsigned seq;
+
+  lock_acquire (&journal_lock);
+  seq = commit_seq;
+  while (enabled && logged_cnt > 0 && commit_seq == seq)
+    {
+      if (outstanding == 0)
+        commit ();
+      else
+        {
+          waiters++;
+          cond_wait (&journal_changed, &journal_lock);
+          waiters--;
+        }
+    }
+  lock_release (&journal_lock);
+}
+
+/* Writes SIZE bytes from BUFFER + BUFFER_OFS to SECTOR at
+   SECTOR_OFS as part of the running transaction.
+
+   If the transaction already holds JOURNAL_CAPACITY sectors, it
+   is committed on the spot.  Operations that are still in
+   progress then lose their atomicity with respect to a crash,
+   but the log never contains a torn sector, because all
+   metadata writes are serialized by journal_lock. */
+void
+journal_write (block_sector_t sector, int sector_ofs, off_t buffer_ofs,
+               size_t size, const void *buffer)
+{
+  size_t i;
+
+  if (!enabled)
+    {
+      cache_write (sector, sector_ofs, buffer_ofs, size, buffer);
+      return;
+    }
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < logged_cnt; i++)
+    if (logged[i] == sector)
+      break;
+  if (i == logged_cnt)
+    {
+      if (logged_cnt == JOURNAL_CAPACITY)
+        commit ();
+      logged[logged_cnt++] = sector;
+    }
+  cache_write_logged (sector, sector_ofs, buffer_ofs, size, buffer);
+  lock_release (&journal_lock);
+}
+
+/* Commits the running transaction: copies every logged sector
+   to the log region, then writes the header.  Afterwards the
+   sectors may be written back by the cache at any time.
+   JOURNAL_LOCK must be held. */
+static void
+commit (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  if (logged_cnt == 0)
+    return;
+
+  /* The log region is reused, so the previous transaction must
+     reach its home sectors first. */
+  checkpoint ();
+
+  for (i = 0; i < logged_cnt; i++)
+    {
+      uint8_t *data = ckpt_data + i * BLOCK_SECTOR_SIZE;
+      cache_read (logged[i], 0, 0, BLOCK_SECTOR_SIZE, data);
+      ckpt_home[i] = header->home[i] = logged[i];
+    }
+  block_write_multiple (fs_device, JOURNAL_SECTOR + 1, logged_cnt, ckpt_data);
+  header->cnt = logged_cnt;
+  block_write (fs_device, JOURNAL_SECTOR, header);
+
+  for (i = 0; i < logged_cnt; i++)
+    cache_unlog (logged[i]);
+  ckpt_cnt = logged_cnt;
+  logged_cnt = 0;
+  commit_seq++;
+  cond_broadcast (&journal_changed, &journal_lock);
+}
+
+/* Writes the last committed transaction to its home sectors and
+   marks the log clean.  JOURNAL_LOCK must be held. */
+static void
+checkpoint (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  if (ckpt_cnt == 0)
+    return;
+
+  for (i = 0; i < ckpt_cnt; i++)
+    cache_checkpoint (ckpt_home[i], ckpt_data + i * BLOCK_SECTOR_SIZE);
+  header->cnt = 0;
+  block_write (fs_device, JOURNAL_SECTOR, header);
+  ckpt_cnt = 0;
+}
+
+/* Copies committed records left in the log by an unclean
+   shutdown to their home sectors.  Runs before anything is
+   cached, so it can use the block device directly, and before
+   any commit, so it can borrow the checkpoint buffer. */
+static void
+replay (void)
+{
+  size_t i;
+
+  block_read (fs_device, JOURNAL_SECTOR, header);
+  if (header->magic == JOURNAL_MAGIC && header->cnt > 0
+      && header->cnt <= JOURNAL_CAPACITY)
+    {
+      printf ("Replaying file system journal (%"PRIu32" sectors)...",
+              header->cnt);
+      block_read_multiple (fs_device, JOURNAL_SECTOR + 1, header->cnt,
+                           ckpt_data);
+      for (i = 0; i < header->cnt; i++)
+        block_write (fs_device, header->home[i],
+                     ckpt_data + i * BLOCK_SECTOR_SIZE);
+      printf ("done.\n");
+    }
+}
+
+/* Background thread: periodically groups finished operations
+   into a commit and checkpoints committed transactions. */
+static void
+journal_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_msleep (JOURNAL_INTERVAL_MS);
+
+      lock_acquire (&journal_lock);
+      if (enabled)
+        {
+          if (outstanding == 0)
+            commit ();
+          checkpoint ();
+        }
+      lock_release (&journal_lock);
+    }
+}
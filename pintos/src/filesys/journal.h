@@ -0,0 +1,38 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+
+/* Write-ahead log for file system metadata.
+
+   Inode sectors, indirect blocks, directory contents and the
+   free map are written with journal_write() instead of
+   cache_write().  Such sectors stay pinned in the buffer cache
+   until the running transaction commits, which copies all of
+   them to the log region in one sequential write followed by
+   the log header (the commit point).  The journal thread then
+   checkpoints them to their home sectors in the background.
+
+   Each system call that modifies the file system brackets its
+   updates with journal_begin() and journal_end(), and several
+   such operations are grouped into a single commit. */
+
+/* Number of log records, that is, metadata sectors a single
+   transaction may modify.  The log region occupies
+   JOURNAL_SECTORS sectors starting at JOURNAL_SECTOR. */
+#define JOURNAL_CAPACITY 32
+#define JOURNAL_SECTORS (1 + JOURNAL_CAPACITY)
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_flush (void);
+
+void journal_write (block_sector_t, int, off_t, size_t, const void*);
+
+#endif /* filesys/journal.h */
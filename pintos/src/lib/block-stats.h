@@ -0,0 +1,26 @@
+#ifndef __LIB_BLOCK_STATS_H
+#define __LIB_BLOCK_STATS_H
+
+#include <stdint.h>
+
+/* Number of buckets in a block device latency histogram.
+   Bucket I counts requests that took from 2**I to 2**(I+1) - 1
+   CPU cycles; bucket 0 also counts those that took none. */
+#define BLOCK_STATS_BUCKETS 40
+
+/* Block device statistics, as returned by the blockstats()
+   system call and printed at shutdown. */
+struct block_stats
+  {
+    uint64_t read_bytes;                /* Bytes read. */
+    uint64_t write_bytes;               /* Bytes written. */
+    uint32_t requests;                  /* Completed requests. */
+    uint32_t sequential;                /* Requests starting where the
+                                           previous one ended. */
+    uint32_t outstanding;               /* Requests submitted, not completed. */
+    uint32_t peak_outstanding;          /* Maximum of OUTSTANDING. */
+    uint32_t wait[BLOCK_STATS_BUCKETS];     /* Time queued before dispatch. */
+    uint32_t service[BLOCK_STATS_BUCKETS];  /* Time in the driver. */
+  };
+
+#endif /* lib/block-stats.h */
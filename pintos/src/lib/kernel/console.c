@@ -6,9 +6,14 @@
 #include "threads/init.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void acquire_console (void);
+static void release_console (void);
+static void flush_have_lock (void);
+static thread_func console_writer;
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,14 +64,58 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* Console log ring.
+
+   console_write_async() copies its output into the ring and
+   returns, and the low-priority "console" thread later writes it
+   to the display and serial port.  A writer that finds the ring
+   full drains it itself, so no writer gets more than RING_SIZE
+   bytes ahead of the console, and none depends on the console
+   thread, which any busy thread can starve, to make room.
+
+   Writers take ring_lock to append.  The ring is drained with
+   the console lock held, by the console thread or by any other
+   output to the console, which must not overtake bytes that were
+   written earlier.  The head and tail indexes are read and
+   written with interrupts off. */
+#define RING_SIZE 4096
+static char ring[RING_SIZE];
+static size_t ring_head;                /* Next byte is written here. */
+static size_t ring_tail;                /* Next byte is output from here. */
+static struct lock ring_lock;           /* Serializes writers. */
+static struct condition ring_not_empty; /* Signaled by writers. */
+static bool ring_started;               /* Console thread running? */
+static bool ring_draining;              /* Inside flush_have_lock()? */
+
+/* Number of bytes waiting in the ring. */
+static size_t
+ring_used (void)
+{
+  enum intr_level old_level = intr_disable ();
+  size_t used = (ring_head - ring_tail + RING_SIZE) % RING_SIZE;
+  intr_set_level (old_level);
+  return used;
+}
+
 /* Enable console locking. */
 void
 console_init (void)
 {
   lock_init (&console_lock);
+  lock_init (&ring_lock);
+  cond_init (&ring_not_empty);
   use_console_lock = true;
 }
 
+/* Starts the console thread, which enables
+   console_write_async().  Until then, it writes synchronously. */
+void
+console_start (void)
+{
+  if (thread_create ("console", PRI_MIN, console_writer, NULL) != TID_ERROR)
+    ring_started = true;
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
    now on. */
@@ -76,6 +125,16 @@ console_panic (void)
   use_console_lock = false;
 }
 
+/* Writes out everything in the console log ring before
+   returning.  Used on shutdown and panic. */
+void
+console_flush (void)
+{
+  acquire_console ();
+  flush_have_lock ();
+  release_console ();
+}
+
 /* Prints console statistics. */
 void
 console_print_stats (void)
@@ -128,6 +187,7 @@ vprintf (const char *format, va_list args)
   int char_cnt = 0;
 
   acquire_console ();
+  flush_have_lock ();
   __vprintf (format, args, vprintf_helper, &char_cnt);
   release_console ();
 
@@ -140,6 +200,7 @@ int
 puts (const char *s)
 {
   acquire_console ();
+  flush_have_lock ();
   while (*s != '\0')
     putchar_have_lock (*s++);
   putchar_have_lock ('\n');
@@ -153,16 +214,63 @@ void
 putbuf (const char *buffer, size_t n)
 {
   acquire_console ();
+  flush_have_lock ();
   while (n-- > 0)
     putchar_have_lock (*buffer++);
   release_console ();
 }
 
+/* Queues the N characters in BUFFER, which must be in kernel
+   memory, for the console thread to write to the console, and
+   returns without waiting for them to be written unless the
+   console log ring is full, in which case it writes the ring out
+   itself. */
+void
+console_write_async (const char *buffer, size_t n)
+{
+  if (!ring_started || !use_console_lock || intr_context ())
+    {
+      putbuf (buffer, n);
+      return;
+    }
+
+  lock_acquire (&ring_lock);
+  while (n > 0)
+    {
+      enum intr_level old_level;
+      size_t room, head;
+
+      while ((room = RING_SIZE - 1 - ring_used ()) == 0)
+        {
+          /* The console lock comes before ring_lock. */
+          lock_release (&ring_lock);
+          console_flush ();
+          lock_acquire (&ring_lock);
+        }
+
+      /* Only this thread moves the head, and the tail only makes
+         more room, so the copy needs no further locking. */
+      head = ring_head;
+      for (; n > 0 && room > 0; n--, room--)
+        {
+          ring[head] = *buffer++;
+          head = (head + 1) % RING_SIZE;
+        }
+
+      old_level = intr_disable ();
+      ring_head = head;
+      intr_set_level (old_level);
+      cond_signal (&ring_not_empty, &ring_lock);
+    }
+  lock_release (&ring_lock);
+}
+
 /* Writes C to the vga display and serial port. */
 int
 putchar (int c)
 {
   acquire_console ();
+  flush_have_lock ();
   putchar_have_lock (c);
   release_console ();
 
@@ -189,3 +297,54 @@ putchar_have_lock (uint8_t c)
   serial_putc (c);
   vga_putc (c);
 }
+
+/* Writes out the contents of the console log ring, so that
+   output that follows does not overtake it.  The caller has
+   already acquired the console lock if appropriate.
+
+   Does nothing in an interrupt handler, which may have
+   interrupted a drain in progress, except after a panic, when
+   locks are no longer used, or when called recursively from
+   within itself. */
+static void
+flush_have_lock (void)
+{
+  if ((intr_context () && use_console_lock) || ring_draining)
+    return;
+
+  ring_draining = true;
+  while (ring_used () > 0)
+    {
+      enum intr_level old_level;
+      size_t tail;
+
+      old_level = intr_disable ();
+      tail = ring_tail;
+      intr_set_level (old_level);
+
+      putchar_have_lock (ring[tail]);
+
+      old_level = intr_disable ();
+      ring_tail = (tail + 1) % RING_SIZE;
+      intr_set_level (old_level);
+    }
+  ring_draining = false;
+}
+
+/* Console thread: writes the contents of the console log ring
+   to the console whenever there is any. */
+static void
+console_writer (void *aux UNUSED)
+{
+  for (;;)
+    {
+      lock_acquire (&ring_lock);
+      while (ring_used () == 0)
+        cond_wait (&ring_not_empty, &ring_lock);
+      lock_release (&ring_lock);
+
+      acquire_console ();
+      flush_have_lock ();
+      release_console ();
+    }
+}
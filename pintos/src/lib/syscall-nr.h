@@ -29,7 +29,24 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_FSYNC,                  /* Write a file's data to disk. */
+    SYS_SYNC,                   /* Write all file system data to disk. */
+    SYS_COPY_FILE_RANGE,        /* Copy data between fds in the kernel. */
+    SYS_PREAD,                  /* Read from a file at an offset. */
+    SYS_PWRITE,                 /* Write to a file at an offset. */
+    SYS_READV,                  /* Scatter read into several buffers. */
+    SYS_WRITEV,                 /* Gather write from several buffers. */
+    SYS_AIO_SETUP,              /* Map an asynchronous I/O ring. */
+    SYS_AIO_SUBMIT,             /* Submit and reap asynchronous I/O. */
+    SYS_FALLOCATE,              /* Reserve space for a file. */
+    SYS_FTRUNCATE,              /* Change a file's length. */
+    SYS_FADVISE,                /* Declare an access pattern. */
+    SYS_BLOCKSTATS,             /* Get block device statistics. */
+    SYS_CLOCK_GETTIME,          /* Get the time since boot. */
+    SYS_FORK                    /* Duplicate the current process. */
   };
 
 #endif /* lib/syscall-nr.h */
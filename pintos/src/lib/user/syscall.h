@@ -2,7 +2,9 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <block-stats.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -15,6 +17,60 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* Most buffers a readv() or writev() call may pass. */
+#define IOV_MAX 1024
+
+/* One buffer of a readv() or writev() call. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* Asynchronous I/O ring, shared between a process and the
+   kernel.  The process fills submission queue entries and
+   advances SQ_TAIL; the kernel consumes them, advancing SQ_HEAD.
+   The kernel posts completions and advances CQ_TAIL; the process
+   consumes them, advancing CQ_HEAD.  Indexes grow without bound
+   and are taken modulo the queue size. */
+#define AIO_SQ_ENTRIES 64
+#define AIO_CQ_ENTRIES 128
+
+/* Asynchronous I/O operations. */
+#define AIO_READ 0
+#define AIO_WRITE 1
+
+struct aio_sqe
+  {
+    int opcode;                 /* AIO_READ or AIO_WRITE. */
+    int fd;                     /* File descriptor. */
+    void *buffer;               /* Data buffer. */
+    unsigned length;            /* Bytes to transfer. */
+    unsigned offset;            /* Offset in the file. */
+    unsigned user_data;         /* Passed back in the completion. */
+  };
+
+struct aio_cqe
+  {
+    unsigned user_data;         /* From the submission. */
+    int result;                 /* Bytes transferred, or -1. */
+  };
+
+struct aio_ring
+  {
+    unsigned sq_head, sq_tail;
+    unsigned cq_head, cq_tail;
+    struct aio_sqe sq[AIO_SQ_ENTRIES];
+    struct aio_cqe cq[AIO_CQ_ENTRIES];
+  };
+
+/* Access pattern advice for fadvise(). */
+#define FADV_NORMAL 0           /* No particular pattern. */
+#define FADV_SEQUENTIAL 1       /* Read once, front to back. */
+#define FADV_RANDOM 2           /* No locality. */
+#define FADV_WILLNEED 3         /* Range will be needed soon. */
+#define FADV_DONTNEED 4         /* Range won't be needed again. */
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -46,4 +102,21 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+bool fsync (int fd);
+void sync (void);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+bool aio_setup (struct aio_ring *ring);
+int aio_submit (unsigned to_submit, unsigned min_complete);
+bool fallocate (int fd, unsigned offset, unsigned length);
+bool ftruncate (int fd, unsigned length);
+bool fadvise (int fd, unsigned offset, unsigned length, int advice);
+bool blockstats (const char *device, struct block_stats *stats);
+void clock_gettime (int64_t *ns);
+pid_t fork (void);
+
 #endif /* lib/user/syscall.h */
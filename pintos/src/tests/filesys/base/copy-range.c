@@ -0,0 +1,42 @@
+/* Copies part of one file into another with copy_file_range(),
+   including a copy cut short by the end of the source, then
+   checks that a copy between overlapping ranges of one file is
+   refused. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[3000];
+
+void
+test_main (void)
+{
+  int src, dst, src2;
+
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((src = open ("src")) > 1, "open \"src\"");
+  CHECK ((dst = open ("dst")) > 1, "open \"dst\"");
+  random_bytes (buf, sizeof buf);
+  CHECK (write (src, buf, sizeof buf) == sizeof buf, "write \"src\"");
+
+  msg ("seek \"src\" to 100");
+  seek (src, 100);
+  CHECK (copy_file_range (src, dst, 2000) == 2000,
+         "copy 2000 bytes from \"src\" to \"dst\"");
+  CHECK (copy_file_range (src, dst, 2000) == 900,
+         "copy to end of \"src\"");
+  CHECK (tell (src) == sizeof buf && tell (dst) == 2900,
+         "both positions advanced");
+  check_file ("dst", buf + 100, sizeof buf - 100);
+
+  CHECK ((src2 = open ("src")) > 1, "open \"src\" again");
+  msg ("seek \"src\" to 0 and 10");
+  seek (src, 0);
+  seek (src2, 10);
+  CHECK (copy_file_range (src, src2, 100) == -1,
+         "overlapping copy within \"src\" fails");
+  check_file ("src", buf, sizeof buf);
+}
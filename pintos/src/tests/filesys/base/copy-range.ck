@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "src"
+(copy-range) create "dst"
+(copy-range) open "src"
+(copy-range) open "dst"
+(copy-range) write "src"
+(copy-range) seek "src" to 100
+(copy-range) copy 2000 bytes from "src" to "dst"
+(copy-range) copy to end of "src"
+(copy-range) both positions advanced
+(copy-range) open "dst" for verification
+(copy-range) verified contents of "dst"
+(copy-range) close "dst"
+(copy-range) open "src" again
+(copy-range) seek "src" to 0 and 10
+(copy-range) overlapping copy within "src" fails
+(copy-range) open "src" for verification
+(copy-range) verified contents of "src"
+(copy-range) close "src"
+(copy-range) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Run with -dma.  Writes a file in uneven pieces, syncs it so the
+   sectors go to the disk by bus-master DMA, drops it from the cache
+   and reads it back from the disk the same way. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[30000];
+
+void
+test_main (void)
+{
+  const char *file_name = "dma";
+  size_t ofs;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  msg ("write \"%s\" in uneven pieces", file_name);
+  for (ofs = 0; ofs < sizeof buf; )
+    {
+      size_t size = random_ulong () % 3000 + 1;
+      if (size > sizeof buf - ofs)
+        size = sizeof buf - ofs;
+      if (write (fd, buf + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu failed", size, ofs);
+      ofs += size;
+    }
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  CHECK (fadvise (fd, 0, 0, FADV_DONTNEED), "drop \"%s\" from the cache",
+         file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
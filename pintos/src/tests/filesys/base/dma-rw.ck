@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dma-rw) begin
+(dma-rw) create "dma"
+(dma-rw) open "dma"
+(dma-rw) write "dma" in uneven pieces
+(dma-rw) fsync "dma"
+(dma-rw) drop "dma" from the cache
+(dma-rw) close "dma"
+(dma-rw) open "dma" for verification
+(dma-rw) verified contents of "dma"
+(dma-rw) close "dma"
+(dma-rw) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Checks that fadvise() rejects bad handles, ranges and advice,
+   and that reading a file under each kind of advice, including
+   after dropping its cached sectors, returns the data written. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[23456];
+
+void
+test_main (void)
+{
+  const char *file_name = "advised";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+
+  CHECK (!fadvise (-1, 0, 0, FADV_NORMAL), "fadvise -1 fails");
+  CHECK (!fadvise (fd, 0, 0, FADV_DONTNEED + 1), "fadvise bad advice fails");
+  CHECK (!fadvise (fd, 0x80000000, 1, FADV_NORMAL),
+         "fadvise negative offset fails");
+  CHECK (!fadvise (fd, 0x7ffffff0, 0x20, FADV_NORMAL),
+         "fadvise overflowing range fails");
+
+  CHECK (fadvise (fd, 0, 0, FADV_DONTNEED), "fadvise DONTNEED");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  CHECK (fadvise (fd, 0, 0, FADV_SEQUENTIAL), "fadvise SEQUENTIAL");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  CHECK (fadvise (fd, 0, sizeof buf, FADV_WILLNEED), "fadvise WILLNEED");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  CHECK (fadvise (fd, 0, 0, FADV_RANDOM), "fadvise RANDOM");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  CHECK (fadvise (fd, 0, 0, FADV_NORMAL), "fadvise NORMAL");
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (!fadvise (fd, 0, 0, FADV_NORMAL), "fadvise closed handle fails");
+  check_file (file_name, buf, sizeof buf);
+}
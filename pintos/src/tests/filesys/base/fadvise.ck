@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fadvise) begin
+(fadvise) create "advised"
+(fadvise) open "advised"
+(fadvise) write "advised"
+(fadvise) fadvise -1 fails
+(fadvise) fadvise bad advice fails
+(fadvise) fadvise negative offset fails
+(fadvise) fadvise overflowing range fails
+(fadvise) fadvise DONTNEED
+(fadvise) verified contents of "advised"
+(fadvise) fadvise SEQUENTIAL
+(fadvise) verified contents of "advised"
+(fadvise) fadvise WILLNEED
+(fadvise) verified contents of "advised"
+(fadvise) fadvise RANDOM
+(fadvise) verified contents of "advised"
+(fadvise) fadvise NORMAL
+(fadvise) close "advised"
+(fadvise) fadvise closed handle fails
+(fadvise) open "advised" for verification
+(fadvise) verified contents of "advised"
+(fadvise) close "advised"
+(fadvise) end
+EOF
+pass;
@@ -0,0 +1,31 @@
+/* Writes a file, flushes it with fsync() and sync(), and checks
+   that it reads back intact.  Also checks that fsync() refuses
+   handles that are not open. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[5678];
+
+void
+test_main (void)
+{
+  const char *file_name = "synced";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  CHECK (!fsync (fd), "fsync closed handle fails");
+  CHECK (!fsync (-1), "fsync -1 fails");
+  msg ("sync");
+  sync ();
+  check_file (file_name, buf, sizeof buf);
+}
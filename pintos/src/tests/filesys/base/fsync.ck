@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync) begin
+(fsync) create "synced"
+(fsync) open "synced"
+(fsync) write "synced"
+(fsync) fsync "synced"
+(fsync) close "synced"
+(fsync) fsync closed handle fails
+(fsync) fsync -1 fails
+(fsync) sync
+(fsync) open "synced" for verification
+(fsync) verified contents of "synced"
+(fsync) close "synced"
+(fsync) end
+EOF
+pass;
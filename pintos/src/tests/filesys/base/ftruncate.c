@@ -0,0 +1,43 @@
+/* Reserves space past the end of a file with fallocate(), which
+   must not change its size, then grows and shrinks the file with
+   ftruncate() and checks that bytes past the old end read back
+   as zeros, including those that were cut off and grown back. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[6000];
+char expected[6000];
+
+void
+test_main (void)
+{
+  const char *file_name = "trunc";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (expected, 1000);
+  CHECK (write (fd, expected, 1000) == 1000, "write 1000 bytes");
+
+  CHECK (fallocate (fd, 0, 20000), "fallocate 20000 bytes");
+  CHECK (filesize (fd) == 1000, "size is still 1000");
+
+  CHECK (ftruncate (fd, 6000), "grow to 6000 bytes");
+  CHECK (filesize (fd) == 6000, "size is 6000");
+  msg ("seek to 0");
+  seek (fd, 0);
+  CHECK (read (fd, buf, 6000) == 6000, "read 6000 bytes");
+  compare_bytes (buf, expected, 6000, 0, file_name);
+
+  CHECK (ftruncate (fd, 100), "shrink to 100 bytes");
+  CHECK (filesize (fd) == 100, "size is 100");
+  CHECK (ftruncate (fd, 3000), "grow to 3000 bytes");
+  memset (expected + 100, 0, 900);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, expected, 3000);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ftruncate) begin
+(ftruncate) create "trunc"
+(ftruncate) open "trunc"
+(ftruncate) write 1000 bytes
+(ftruncate) fallocate 20000 bytes
+(ftruncate) size is still 1000
+(ftruncate) grow to 6000 bytes
+(ftruncate) size is 6000
+(ftruncate) seek to 0
+(ftruncate) read 6000 bytes
+(ftruncate) shrink to 100 bytes
+(ftruncate) size is 100
+(ftruncate) grow to 3000 bytes
+(ftruncate) close "trunc"
+(ftruncate) open "trunc" for verification
+(ftruncate) verified contents of "trunc"
+(ftruncate) close "trunc"
+(ftruncate) end
+EOF
+pass;
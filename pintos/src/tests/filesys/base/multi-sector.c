@@ -0,0 +1,34 @@
+/* Writes a file spanning many sectors and syncs it, so write-back
+   sends runs of neighbouring sectors to the disk at once, then
+   drops the file from the cache and reads it back through a
+   multi-sector prefetch. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[40000];
+
+void
+test_main (void)
+{
+  const char *file_name = "multi";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  msg ("sync");
+  sync ();
+  CHECK (fadvise (fd, 0, 0, FADV_DONTNEED), "drop \"%s\" from the cache",
+         file_name);
+  CHECK (fadvise (fd, 0, sizeof buf, FADV_WILLNEED),
+         "prefetch \"%s\"", file_name);
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(multi-sector) begin
+(multi-sector) create "multi"
+(multi-sector) open "multi"
+(multi-sector) write "multi"
+(multi-sector) sync
+(multi-sector) drop "multi" from the cache
+(multi-sector) prefetch "multi"
+(multi-sector) verified contents of "multi"
+(multi-sector) close "multi"
+(multi-sector) end
+EOF
+pass;
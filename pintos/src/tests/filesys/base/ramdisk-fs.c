@@ -0,0 +1,38 @@
+/* Run with -ramdisk=512 -filesys=rd0, so that the file system,
+   this program included, lives on the RAM disk.  Writes a file,
+   drops it from the cache and checks that it reads back from the
+   RAM disk intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[20000];
+
+void
+test_main (void)
+{
+  const char *file_name = "in-ram";
+  struct block_stats stats;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  CHECK (fadvise (fd, 0, 0, FADV_DONTNEED), "drop \"%s\" from the cache",
+         file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  CHECK (blockstats ("rd0", &stats), "blockstats \"rd0\"");
+  if (stats.write_bytes < sizeof buf)
+    fail ("rd0 wrote only %d bytes", (int) stats.write_bytes);
+  if (stats.read_bytes == 0)
+    fail ("rd0 read nothing");
+  msg ("rd0 saw the reads and writes");
+}
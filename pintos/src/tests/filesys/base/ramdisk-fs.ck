@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ramdisk-fs) begin
+(ramdisk-fs) create "in-ram"
+(ramdisk-fs) open "in-ram"
+(ramdisk-fs) write "in-ram"
+(ramdisk-fs) fsync "in-ram"
+(ramdisk-fs) drop "in-ram" from the cache
+(ramdisk-fs) close "in-ram"
+(ramdisk-fs) open "in-ram" for verification
+(ramdisk-fs) verified contents of "in-ram"
+(ramdisk-fs) close "in-ram"
+(ramdisk-fs) blockstats "rd0"
+(ramdisk-fs) rd0 saw the reads and writes
+(ramdisk-fs) end
+EOF
+pass;
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sched-deadline) begin
+(sched-deadline) create "a"
+(sched-deadline) create "b"
+(sched-deadline) blockstats "hda"
+(sched-deadline) fork and write "a" and "b" at once
+(sched-deadline) wait(fork()) = 0
+(sched-deadline) open "a" for verification
+(sched-deadline) verified contents of "a"
+(sched-deadline) close "a"
+(sched-deadline) open "b" for verification
+(sched-deadline) verified contents of "b"
+(sched-deadline) close "b"
+(sched-deadline) blockstats "hda"
+(sched-deadline) hda wrote both files
+(sched-deadline) end
+EOF
+pass;
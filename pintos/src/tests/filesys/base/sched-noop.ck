@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sched-noop) begin
+(sched-noop) create "a"
+(sched-noop) create "b"
+(sched-noop) blockstats "hda"
+(sched-noop) fork and write "a" and "b" at once
+(sched-noop) wait(fork()) = 0
+(sched-noop) open "a" for verification
+(sched-noop) verified contents of "a"
+(sched-noop) close "a"
+(sched-noop) open "b" for verification
+(sched-noop) verified contents of "b"
+(sched-noop) close "b"
+(sched-noop) blockstats "hda"
+(sched-noop) hda wrote both files
+(sched-noop) end
+EOF
+pass;
@@ -0,0 +1,5 @@
+/* Run with -iosched=scan.  Has two processes write a file each at
+   the same time, and checks both files and that the disk's
+   statistics account for the writes. */
+
+#include "tests/filesys/base/sched.inc"
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sched-scan) begin
+(sched-scan) create "a"
+(sched-scan) create "b"
+(sched-scan) blockstats "hda"
+(sched-scan) fork and write "a" and "b" at once
+(sched-scan) wait(fork()) = 0
+(sched-scan) open "a" for verification
+(sched-scan) verified contents of "a"
+(sched-scan) close "a"
+(sched-scan) open "b" for verification
+(sched-scan) verified contents of "b"
+(sched-scan) close "b"
+(sched-scan) blockstats "hda"
+(sched-scan) hda wrote both files
+(sched-scan) end
+EOF
+pass;
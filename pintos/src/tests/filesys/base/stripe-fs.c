@@ -0,0 +1,47 @@
+/* Run with -ramdisk=512 -stripe=rd0,hda2 -stripe-chunk=4
+   -filesys=md0, so that the file system lives on a striped device
+   whose members are the RAM disk and the disk's file system
+   partition.  Writes a file spanning many chunks, drops it from
+   the cache, checks that it reads back intact and that both
+   members carried part of the traffic. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+char buf[40000];
+
+/* Checks that DEVICE has written some data. */
+static void
+check_written (const char *device)
+{
+  struct block_stats stats;
+
+  CHECK (blockstats (device, &stats), "blockstats \"%s\"", device);
+  if (stats.write_bytes == 0)
+    fail ("%s wrote nothing", device);
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "striped";
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  CHECK (fadvise (fd, 0, 0, FADV_DONTNEED), "drop \"%s\" from the cache",
+         file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  check_written ("md0");
+  check_written ("rd0");
+  check_written ("hda2");
+}
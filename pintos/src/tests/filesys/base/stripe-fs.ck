@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stripe-fs) begin
+(stripe-fs) create "striped"
+(stripe-fs) open "striped"
+(stripe-fs) write "striped"
+(stripe-fs) fsync "striped"
+(stripe-fs) drop "striped" from the cache
+(stripe-fs) close "striped"
+(stripe-fs) open "striped" for verification
+(stripe-fs) verified contents of "striped"
+(stripe-fs) close "striped"
+(stripe-fs) blockstats "md0"
+(stripe-fs) blockstats "rd0"
+(stripe-fs) blockstats "hda2"
+(stripe-fs) end
+EOF
+pass;
@@ -0,0 +1,7 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%j) = map { ($_ => ["file $_"]) } grep ($_ % 2, 0...39);
+check_archive ({'j' => \%j});
+pass;
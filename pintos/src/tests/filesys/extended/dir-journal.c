@@ -0,0 +1,64 @@
+/* Creates, writes and removes many files in one directory, far
+   more metadata updates than one journal commit holds, and checks
+   that the directory reads back right.  The persistence check
+   then makes sure the journaled updates reached the disk. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+void
+test_main (void)
+{
+  char name[32], contents[32];
+  int i, fd;
+
+  CHECK (mkdir ("j"), "mkdir \"j\"");
+
+  msg ("creating and writing j/0 through j/%d...", FILE_CNT - 1);
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      snprintf (contents, sizeof contents, "file %d", i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      CHECK (write (fd, contents, strlen (contents)) == (int) strlen (contents),
+             "write \"%s\"", name);
+      close (fd);
+    }
+  quiet = false;
+
+  msg ("removing even-numbered files...");
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+
+  msg ("checking j/0 through j/%d...", FILE_CNT - 1);
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "j/%d", i);
+      fd = open (name);
+      if (i % 2 == 0)
+        {
+          if (fd != -1)
+            fail ("removed \"%s\" still opens", name);
+          continue;
+        }
+      snprintf (contents, sizeof contents, "file %d", i);
+      if (fd < 2)
+        fail ("open \"%s\" failed", name);
+      check_file_handle (fd, name, contents, strlen (contents));
+      close (fd);
+    }
+  quiet = false;
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-journal) begin
+(dir-journal) mkdir "j"
+(dir-journal) creating and writing j/0 through j/39...
+(dir-journal) removing even-numbered files...
+(dir-journal) checking j/0 through j/39...
+(dir-journal) end
+EOF
+pass;
@@ -0,0 +1,6 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({"delayed" => ["a" x 3000, "\0" x 7000, "b" x 2000]});
+pass;
@@ -0,0 +1,48 @@
+/* Writes two runs of data with a hole between them, which leaves
+   their sectors unallocated until write-back, and checks that the
+   file reads back right while it is still open, after fsync() and
+   after the last close. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FIRST_SIZE 3000
+#define HOLE_END 10000
+#define SECOND_SIZE 2000
+
+static char buf[HOLE_END + SECOND_SIZE];
+
+void
+test_main (void)
+{
+  const char *file_name = "delayed";
+  int fd;
+
+  memset (buf, 'a', FIRST_SIZE);
+  memset (buf + HOLE_END, 'b', SECOND_SIZE);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, FIRST_SIZE) == FIRST_SIZE,
+         "write %d bytes at offset 0", FIRST_SIZE);
+  msg ("seek \"%s\" to %d", file_name, HOLE_END);
+  seek (fd, HOLE_END);
+  CHECK (write (fd, buf + HOLE_END, SECOND_SIZE) == SECOND_SIZE,
+         "write %d bytes at offset %d", SECOND_SIZE, HOLE_END);
+  CHECK (filesize (fd) == (int) sizeof buf, "filesize is %d", (int) sizeof buf);
+
+  msg ("read back before write-back");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  CHECK (fsync (fd), "fsync \"%s\"", file_name);
+  msg ("read back after fsync");
+  seek (fd, 0);
+  check_file_handle (fd, file_name, buf, sizeof buf);
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-delayed) begin
+(grow-delayed) create "delayed"
+(grow-delayed) open "delayed"
+(grow-delayed) write 3000 bytes at offset 0
+(grow-delayed) seek "delayed" to 10000
+(grow-delayed) write 2000 bytes at offset 10000
+(grow-delayed) filesize is 12000
+(grow-delayed) read back before write-back
+(grow-delayed) verified contents of "delayed"
+(grow-delayed) fsync "delayed"
+(grow-delayed) read back after fsync
+(grow-delayed) verified contents of "delayed"
+(grow-delayed) close "delayed"
+(grow-delayed) open "delayed" for verification
+(grow-delayed) verified contents of "delayed"
+(grow-delayed) close "delayed"
+(grow-delayed) end
+EOF
+pass;
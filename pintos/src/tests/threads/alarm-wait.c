@@ -24,6 +24,15 @@ test_alarm_multiple (void)
   test_sleep (5, 7);
 }
 
+void
+test_alarm_tickless (void)
+{
+  /* Run with -tickless, so each wakeup comes from a one-shot
+     timer interrupt programmed for the earliest sleeper. */
+  ASSERT (timer_tickless);
+  test_sleep (5, 7);
+}
+
 /* Information about the test. */
 struct sleep_test
   {
@@ -0,0 +1,75 @@
+/* Adds kernel timers that expire from half a millisecond to
+   three seconds away, so that they land on different levels of
+   the timer wheel, in scrambled order, and cancels one of them.
+   Checks that the rest expire once each, in order, and none
+   before its time, and that canceling an expired timer fails. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "devices/timer.h"
+
+#define TIMER_CNT 8
+
+/* Microseconds from the start of the test to each timer's
+   expiry, in the order they are added. */
+static const int64_t delays[TIMER_CNT] =
+  {2000000, 500, 300000, 20000, 1000000, 5000, 3000000, 100000};
+
+/* Index of the timer to cancel. */
+#define CANCELED 4
+
+static struct timer timers[TIMER_CNT];
+static int64_t expired_at[TIMER_CNT];   /* timer_clock() on expiry. */
+static int order[TIMER_CNT];            /* Timer indexes, in expiry order. */
+static int expired_cnt;
+
+/* Records that timer T expired, and when. */
+static void
+expire (struct timer *t)
+{
+  int i = t - timers;
+
+  expired_at[i] = timer_clock ();
+  order[expired_cnt++] = i;
+}
+
+void
+test_timer_wheel (void)
+{
+  int64_t start;
+  int i;
+
+  msg ("Adding %d timers, from 500 us to 3 s away.", TIMER_CNT);
+  start = timer_clock ();
+  for (i = 0; i < TIMER_CNT; i++)
+    {
+      timer_setup (&timers[i], expire, NULL);
+      timer_add (&timers[i], start + delays[i] * TIMER_CLOCK_FREQ / 1000000);
+    }
+  if (!timer_cancel (&timers[CANCELED]))
+    fail ("canceling a pending timer failed");
+  msg ("Canceled the %lld us timer.", delays[CANCELED]);
+
+  /* Every timer has expired or been canceled by the time this
+     returns, so the interrupt handler no longer touches ORDER. */
+  timer_msleep (3500);
+
+  if (expired_cnt != TIMER_CNT - 1)
+    fail ("%d timers expired instead of %d", expired_cnt, TIMER_CNT - 1);
+  for (i = 0; i < expired_cnt; i++)
+    {
+      struct timer *t = &timers[order[i]];
+
+      if (expired_at[order[i]] < t->expires)
+        fail ("%lld us timer expired early", delays[order[i]]);
+      if (i > 0 && delays[order[i]] < delays[order[i - 1]])
+        fail ("%lld us timer expired after %lld us timer",
+              delays[order[i]], delays[order[i - 1]]);
+    }
+
+  for (i = 0; i < expired_cnt; i++)
+    msg ("%lld us timer expired.", delays[order[i]]);
+  if (timer_cancel (&timers[order[0]]))
+    fail ("canceling an expired timer succeeded");
+  pass ();
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(timer-wheel) begin
+(timer-wheel) Adding 8 timers, from 500 us to 3 s away.
+(timer-wheel) Canceled the 1000000 us timer.
+(timer-wheel) 500 us timer expired.
+(timer-wheel) 5000 us timer expired.
+(timer-wheel) 20000 us timer expired.
+(timer-wheel) 100000 us timer expired.
+(timer-wheel) 300000 us timer expired.
+(timer-wheel) 2000000 us timer expired.
+(timer-wheel) 3000000 us timer expired.
+(timer-wheel) PASS
+(timer-wheel) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Writes a file and reads it back through the asynchronous I/O
+   ring, several requests at a time, and checks that every
+   request completes once with the right result.  Also checks
+   that a process gets only one ring and that requests on a bad
+   handle, or at offsets past 2**31 - 1, complete with -1. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define REQ_CNT 8
+#define CHUNK 512
+
+static struct aio_ring *ring = (struct aio_ring *) 0x10000000;
+static char buf1[REQ_CNT * CHUNK];
+static char buf2[REQ_CNT * CHUNK];
+
+/* Queues a request in the ring without submitting it. */
+static void
+queue (int opcode, int fd, void *buffer, unsigned length,
+       unsigned offset, unsigned user_data)
+{
+  struct aio_sqe *sqe = &ring->sq[ring->sq_tail % AIO_SQ_ENTRIES];
+
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->buffer = buffer;
+  sqe->length = length;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring->sq_tail++;
+}
+
+/* Submits the CNT requests queued with user data 0...CNT - 1,
+   waits for them all and checks that each completed once with
+   RESULT. */
+static void
+submit_and_reap (unsigned cnt, int result)
+{
+  unsigned seen = 0;
+  unsigned i;
+
+  if (aio_submit (cnt, cnt) != (int) cnt)
+    fail ("aio_submit did not take %u requests", cnt);
+  if (ring->sq_head != ring->sq_tail)
+    fail ("submission queue not drained");
+  if (ring->cq_tail - ring->cq_head != cnt)
+    fail ("%u completions posted, expected %u",
+          ring->cq_tail - ring->cq_head, cnt);
+  for (i = 0; i < cnt; i++)
+    {
+      struct aio_cqe *cqe = &ring->cq[ring->cq_head++ % AIO_CQ_ENTRIES];
+      if (cqe->user_data >= cnt || (seen & (1u << cqe->user_data)))
+        fail ("unexpected completion for request %u", cqe->user_data);
+      seen |= 1u << cqe->user_data;
+      if (cqe->result != result)
+        fail ("request %u completed with %d, expected %d",
+              cqe->user_data, cqe->result, result);
+    }
+}
+
+void
+test_main (void)
+{
+  int handle;
+  unsigned i;
+
+  CHECK (aio_setup (ring), "aio_setup");
+  CHECK (!aio_setup ((struct aio_ring *) 0x10001000),
+         "second aio_setup fails");
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((handle = open ("data")) > 1, "open \"data\"");
+
+  random_bytes (buf1, sizeof buf1);
+  for (i = 0; i < REQ_CNT; i++)
+    queue (AIO_WRITE, handle, buf1 + i * CHUNK, CHUNK, i * CHUNK, i);
+  msg ("write %d chunks", REQ_CNT);
+  submit_and_reap (REQ_CNT, CHUNK);
+
+  for (i = 0; i < REQ_CNT; i++)
+    queue (AIO_READ, handle, buf2 + i * CHUNK, CHUNK, i * CHUNK, i);
+  msg ("read %d chunks", REQ_CNT);
+  submit_and_reap (REQ_CNT, CHUNK);
+  compare_bytes (buf2, buf1, sizeof buf1, 0, "data");
+
+  queue (AIO_READ, 1234, buf2, CHUNK, 0, 0);
+  msg ("read from bad handle");
+  submit_and_reap (1, -1);
+
+  queue (AIO_READ, handle, buf2, CHUNK, 0x80000000, 0);
+  queue (AIO_WRITE, handle, buf1, CHUNK, 0xfffffff0, 1);
+  queue (AIO_WRITE, handle, buf1, CHUNK, 0x7ffffffa, 2);
+  msg ("requests at bad offsets");
+  submit_and_reap (3, -1);
+  msg ("close \"data\"");
+  close (handle);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(aio-ring) begin
+(aio-ring) aio_setup
+(aio-ring) second aio_setup fails
+(aio-ring) create "data"
+(aio-ring) open "data"
+(aio-ring) write 8 chunks
+(aio-ring) read 8 chunks
+(aio-ring) read from bad handle
+(aio-ring) requests at bad offsets
+(aio-ring) close "data"
+(aio-ring) end
+aio-ring: exit(0)
+EOF
+pass;
@@ -0,0 +1,54 @@
+/* Checks that blockstats() knows the disk but not a made-up
+   device, that a synced write shows up in the disk's statistics,
+   and that every completed request lands in both latency
+   histograms. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[8192];
+
+/* Returns the sum of the CNT counts in HISTOGRAM. */
+static uint32_t
+sum (const uint32_t *histogram, size_t cnt)
+{
+  uint32_t total = 0;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    total += histogram[i];
+  return total;
+}
+
+void
+test_main (void)
+{
+  struct block_stats before, after;
+  int fd;
+
+  CHECK (!blockstats ("nonesuch", &before), "blockstats \"nonesuch\" fails");
+  CHECK (blockstats ("hda", &before), "blockstats \"hda\"");
+
+  CHECK (create ("counted", 0), "create \"counted\"");
+  CHECK ((fd = open ("counted")) > 1, "open \"counted\"");
+  memset (buf, 'x', sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"counted\"");
+  CHECK (fsync (fd), "fsync \"counted\"");
+  close (fd);
+  CHECK (blockstats ("hda", &after), "blockstats \"hda\"");
+
+  if (after.write_bytes < before.write_bytes + sizeof buf)
+    fail ("hda wrote %d bytes, expected at least %d",
+          (int) (after.write_bytes - before.write_bytes), (int) sizeof buf);
+  msg ("write counted");
+  CHECK (after.requests > before.requests, "requests counted");
+  CHECK (after.peak_outstanding >= 1
+         && after.peak_outstanding >= after.outstanding,
+         "peak queue depth covers current depth");
+  CHECK (sum (after.wait, BLOCK_STATS_BUCKETS) == after.requests,
+         "wait histogram counts every request");
+  CHECK (sum (after.service, BLOCK_STATS_BUCKETS) == after.requests,
+         "service histogram counts every request");
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(blockstats) begin
+(blockstats) blockstats "nonesuch" fails
+(blockstats) blockstats "hda"
+(blockstats) create "counted"
+(blockstats) open "counted"
+(blockstats) write "counted"
+(blockstats) fsync "counted"
+(blockstats) blockstats "hda"
+(blockstats) write counted
+(blockstats) requests counted
+(blockstats) peak queue depth covers current depth
+(blockstats) wait histogram counts every request
+(blockstats) service histogram counts every request
+(blockstats) end
+blockstats: exit(0)
+EOF
+pass;
@@ -0,0 +1,28 @@
+/* Reads the clock with clock_gettime many times in a row and
+   checks that it never goes backward and that it moves. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define READ_CNT 100000
+
+void
+test_main (void)
+{
+  int64_t first, prev, now;
+  int i;
+
+  clock_gettime (&first);
+  prev = first;
+  for (i = 0; i < READ_CNT; i++)
+    {
+      clock_gettime (&now);
+      if (now < prev)
+        fail ("clock went back from %lld to %lld ns",
+              (long long) prev, (long long) now);
+      prev = now;
+    }
+  msg ("clock never went backward in %d reads", READ_CNT);
+  CHECK (prev > first, "clock advanced");
+}
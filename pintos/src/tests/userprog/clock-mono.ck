@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(clock-mono) begin
+(clock-mono) clock never went backward in 100000 reads
+(clock-mono) clock advanced
+(clock-mono) end
+clock-mono: exit(0)
+EOF
+pass;
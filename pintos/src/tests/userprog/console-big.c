@@ -0,0 +1,25 @@
+/* Writes more than twice the console's output ring in a single
+   write() to standard output, then exits at once.  All of it must
+   come out, in order, ahead of anything printed afterward. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LINE_CNT 200
+
+static char buf[LINE_CNT * 64];
+
+void
+test_main (void)
+{
+  size_t len = 0;
+  int i;
+
+  for (i = 0; i < LINE_CNT; i++)
+    len += snprintf (buf + len, sizeof buf - len,
+                     "console line %03d: pack my box with five dozen jugs\n",
+                     i);
+  msg ("write returned %d", write (STDOUT_FILENO, buf, len));
+}
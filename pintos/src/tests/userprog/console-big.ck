@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (@expected) = ("(console-big) begin",
+                  map (sprintf ("console line %03d: pack my box with five "
+                                . "dozen jugs", $_), 0...199),
+                  "(console-big) write returned 10200",
+                  "(console-big) end",
+                  "console-big: exit(0)");
+check_expected ([join ('', map ("$_\n", @expected))]);
+pass;
@@ -0,0 +1,32 @@
+/* Passes offsets to pread and pwrite that are out of range, or
+   that the transfer length would carry past 2**31 - 1.  The calls
+   must fail with -1 without touching the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char buf[10];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (pread (handle, buf, sizeof buf, 0x80000000) == -1,
+         "pread at offset 0x80000000 fails");
+  CHECK (pread (handle, buf, sizeof buf, 0x7ffffffa) == -1,
+         "pread past offset 0x7fffffff fails");
+  CHECK (pwrite (handle, buf, sizeof buf, 0xfffffffa) == -1,
+         "pwrite at offset 0xfffffffa fails");
+  CHECK (pread (handle, buf, sizeof buf, 1000) == 0,
+         "pread past end of file reads nothing");
+  CHECK (pread (handle, buf, sizeof buf, 5) == sizeof buf
+         && !memcmp (buf, sample + 5, sizeof buf),
+         "pread 10 bytes at offset 5");
+  msg ("close \"sample.txt\"");
+  close (handle);
+  check_file ("sample.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-offset) begin
+(pread-offset) open "sample.txt"
+(pread-offset) pread at offset 0x80000000 fails
+(pread-offset) pread past offset 0x7fffffff fails
+(pread-offset) pwrite at offset 0xfffffffa fails
+(pread-offset) pread past end of file reads nothing
+(pread-offset) pread 10 bytes at offset 5
+(pread-offset) close "sample.txt"
+(pread-offset) open "sample.txt" for verification
+(pread-offset) verified contents of "sample.txt"
+(pread-offset) close "sample.txt"
+(pread-offset) end
+pread-offset: exit(0)
+EOF
+pass;
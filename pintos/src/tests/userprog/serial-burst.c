@@ -0,0 +1,18 @@
+/* Run with -serial-buf=8192.  Prints many long lines as fast as
+   it can, so that the serial transmit queue fills and drains in
+   FIFO-sized bursts, and relies on the checker to see every line
+   once, in order. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LINE_CNT 300
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < LINE_CNT; i++)
+    msg ("line %03d: the quick brown fox jumps over the lazy dog", i);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (@expected) = ("(serial-burst) begin",
+                  map (sprintf ("(serial-burst) line %03d: the quick brown "
+                                . "fox jumps over the lazy dog", $_), 0...299),
+                  "(serial-burst) end",
+                  "serial-burst: exit(0)");
+check_expected ([join ('', map ("$_\n", @expected))]);
+pass;
@@ -0,0 +1,20 @@
+/* Passes writev more than IOV_MAX buffers, and then a negative
+   count.  The process must be terminated with -1 exit code on
+   the first call. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct iovec iov;
+
+  iov.iov_base = "x";
+  iov.iov_len = 1;
+  writev (STDOUT_FILENO, &iov, IOV_MAX + 1);
+  writev (STDOUT_FILENO, &iov, -1);
+  fail ("should not have survived writev()");
+}
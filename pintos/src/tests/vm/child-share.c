@@ -0,0 +1,58 @@
+/* Child process of page-share.
+   Checks a 256 kB read-only table, which every copy of this
+   program maps from the same shared frames, then dirties 512 kB
+   of its own memory, which pushes shared frames out to be
+   reloaded, and checks the table and its own memory again. */
+
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-share";
+
+/* Entry I of the table. */
+#define ENTRY(I) ((uint32_t) (I) * 2654435761u)
+
+#define T1(I) ENTRY (I)
+#define T4(I) T1 (I), T1 ((I) + 1), T1 ((I) + 2), T1 ((I) + 3)
+#define T16(I) T4 (I), T4 ((I) + 4), T4 ((I) + 8), T4 ((I) + 12)
+#define T64(I) T16 (I), T16 ((I) + 16), T16 ((I) + 32), T16 ((I) + 48)
+#define T256(I) T64 (I), T64 ((I) + 64), T64 ((I) + 128), T64 ((I) + 192)
+#define T1K(I) T256 (I), T256 ((I) + 256), T256 ((I) + 512), T256 ((I) + 768)
+#define T4K(I) T1K (I), T1K ((I) + 1024), T1K ((I) + 2048), T1K ((I) + 3072)
+#define T16K(I) T4K (I), T4K ((I) + 4096), T4K ((I) + 8192), T4K ((I) + 12288)
+#define T64K(I) T16K (I), T16K ((I) + 16384), T16K ((I) + 32768), \
+                T16K ((I) + 49152)
+
+#define TABLE_CNT 65536
+static const uint32_t table[TABLE_CNT] = {T64K (0)};
+
+#define SIZE (512 * 1024)
+static char buf[SIZE];
+
+/* Checks every entry of the table. */
+static void
+check_table (void)
+{
+  size_t i;
+
+  for (i = 0; i < TABLE_CNT; i++)
+    if (table[i] != ENTRY (i))
+      fail ("table entry %zu is %08x, should be %08x",
+            i, table[i], ENTRY (i));
+}
+
+int
+main (void)
+{
+  size_t i;
+
+  check_table ();
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i;
+  check_table ();
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != (char) i)
+      fail ("byte %zu is %02hhx, should be %02hhx", i, buf[i], (char) i);
+  return 0x48;
+}
@@ -0,0 +1,51 @@
+/* Forks, then has the parent and the child each write their own
+   pattern over the same pages, which start out shared
+   copy-on-write, and checks that neither sees the other's
+   writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (16 * 4096)
+
+static char buf[SIZE];
+
+/* Checks that every byte of BUF is C. */
+static void
+check (char c)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != c)
+      fail ("byte %zu is %02hhx, should be %02hhx", i, buf[i], c);
+}
+
+void
+test_main (void)
+{
+  pid_t pid;
+
+  memset (buf, 'a', SIZE);
+  msg ("fork");
+  pid = fork ();
+  if (pid == 0)
+    {
+      check ('a');
+      memset (buf, 'c', SIZE);
+      check ('c');
+      msg ("child wrote its copy");
+      exit (81);
+    }
+  if (pid < 0)
+    fail ("fork failed");
+
+  check ('a');
+  memset (buf, 'p', SIZE);
+  check ('p');
+  msg ("wait(fork()) = %d", wait (pid));
+  check ('p');
+  msg ("parent's copy intact");
+}
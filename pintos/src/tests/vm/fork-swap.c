@@ -0,0 +1,54 @@
+/* Fills more memory than fits in RAM, so that part of it goes to
+   swap, then forks children one at a time that each read part of
+   it, write one page and exit, dropping their share of frames and
+   swap slots that the parent still uses.  Checks that the
+   parent's memory is intact afterward. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+#define CHILD_CNT 4
+
+static char buf[SIZE];
+
+/* Checks every STEP'th byte of BUF, starting at START. */
+static void
+check (size_t start, size_t step)
+{
+  size_t i;
+
+  for (i = start; i < SIZE; i += step)
+    if (buf[i] != (char) (i % 251))
+      fail ("byte %zu is %02hhx, should be %02hhx",
+            i, buf[i], (char) (i % 251));
+}
+
+void
+test_main (void)
+{
+  size_t i;
+  int c;
+
+  msg ("initialize");
+  for (i = 0; i < SIZE; i++)
+    buf[i] = i % 251;
+
+  for (c = 0; c < CHILD_CNT; c++)
+    {
+      pid_t pid = fork ();
+      if (pid == 0)
+        {
+          check (c * 4096, CHILD_CNT * 4096);
+          buf[c * 4096] = ~buf[c * 4096];
+          exit (c);
+        }
+      if (pid < 0)
+        fail ("fork failed");
+      msg ("wait(fork()) = %d", wait (pid));
+    }
+
+  msg ("check");
+  check (0, 1);
+}
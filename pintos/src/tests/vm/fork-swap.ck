@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-swap) begin
+(fork-swap) initialize
+fork-swap: exit(0)
+(fork-swap) wait(fork()) = 0
+fork-swap: exit(1)
+(fork-swap) wait(fork()) = 1
+fork-swap: exit(2)
+(fork-swap) wait(fork()) = 2
+fork-swap: exit(3)
+(fork-swap) wait(fork()) = 3
+(fork-swap) check
+(fork-swap) end
+fork-swap: exit(0)
+EOF
+pass;
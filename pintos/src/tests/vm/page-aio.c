@@ -0,0 +1,60 @@
+/* Reads a file with asynchronous I/O into a page of the BSS that
+   was never touched, which the kernel fills without going through
+   the page table, then forces the page out of memory and checks
+   that the data comes back with it. */
+
+#include <stdint.h>
+#include <round.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (2 * 1024 * 1024)
+
+static char buf[2 * 4096];
+static char big[SIZE];
+
+void
+test_main (void)
+{
+  struct aio_ring *ring = (struct aio_ring *) 0x10000000;
+  char *target = (char *) ROUND_UP ((uintptr_t) buf, 4096);
+  struct aio_sqe *sqe;
+  struct aio_cqe *cqe;
+  int handle;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (aio_setup (ring), "aio_setup");
+
+  sqe = &ring->sq[ring->sq_tail % AIO_SQ_ENTRIES];
+  sqe->opcode = AIO_READ;
+  sqe->fd = handle;
+  sqe->buffer = target;
+  sqe->length = strlen (sample);
+  sqe->offset = 0;
+  sqe->user_data = 1;
+  ring->sq_tail++;
+  CHECK (aio_submit (1, 1) == 1, "submit read of \"sample.txt\"");
+  if (ring->cq_head == ring->cq_tail)
+    fail ("no completion posted");
+  cqe = &ring->cq[ring->cq_head % AIO_CQ_ENTRIES];
+  if (cqe->user_data != 1 || cqe->result != (int) strlen (sample))
+    fail ("read completed with %d, expected %zu",
+          cqe->result, strlen (sample));
+  ring->cq_head++;
+
+  msg ("push buffer out of memory");
+  memset (big, 0x5a, sizeof big);
+  for (i = 0; i < SIZE; i += 4096)
+    if (big[i] != 0x5a)
+      fail ("byte %zu != 0x5a", i);
+
+  msg ("check buffer");
+  if (memcmp (target, sample, strlen (sample)))
+    fail ("data read by aio was lost when its page was evicted");
+
+  close (handle);
+}
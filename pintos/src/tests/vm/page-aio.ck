@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-aio) begin
+(page-aio) open "sample.txt"
+(page-aio) aio_setup
+(page-aio) submit read of "sample.txt"
+(page-aio) push buffer out of memory
+(page-aio) check buffer
+(page-aio) end
+EOF
+pass;
@@ -0,0 +1,64 @@
+/* Streams once through 2.5 MB of cold pages, more than fits in
+   memory, while touching a small set of hot pages between every
+   two cold ones, so that eviction keeps sweeping past pages that
+   are in use.  Then checks every byte of every page.  Run as
+   page-hot-cold with one-handed CLOCK and as page-hot-cold2 with
+   -clock2. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOT_CNT 64
+#define COLD_CNT 640
+
+static char hot[HOT_CNT][PAGE_SIZE];
+static char cold[COLD_CNT][PAGE_SIZE];
+
+/* Returns the byte expected at offset OFS of page PAGE of an
+   array, SALT telling the arrays apart. */
+static char
+expected (size_t page, size_t ofs, int salt)
+{
+  return page * 7 + ofs + salt;
+}
+
+/* Checks the CNT pages of PAGES against SALT. */
+static void
+check_pages (char pages[][PAGE_SIZE], size_t cnt, int salt)
+{
+  size_t page, ofs;
+
+  for (page = 0; page < cnt; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      if (pages[page][ofs] != expected (page, ofs, salt))
+        fail ("page %zu byte %zu is %02hhx, should be %02hhx",
+              page, ofs, pages[page][ofs], expected (page, ofs, salt));
+}
+
+void
+test_main (void)
+{
+  size_t page, ofs;
+
+  msg ("fill %d hot pages", HOT_CNT);
+  for (page = 0; page < HOT_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      hot[page][ofs] = expected (page, ofs, 1);
+
+  msg ("stream through %d cold pages", COLD_CNT);
+  for (page = 0; page < COLD_CNT; page++)
+    {
+      size_t h = page % HOT_CNT;
+
+      for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+        cold[page][ofs] = expected (page, ofs, 2);
+      if (hot[h][page % PAGE_SIZE] != expected (h, page % PAGE_SIZE, 1))
+        fail ("hot page %zu changed", h);
+    }
+
+  msg ("check hot pages");
+  check_pages (hot, HOT_CNT, 1);
+  msg ("check cold pages");
+  check_pages (cold, COLD_CNT, 2);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-hot-cold) begin
+(page-hot-cold) fill 64 hot pages
+(page-hot-cold) stream through 640 cold pages
+(page-hot-cold) check hot pages
+(page-hot-cold) check cold pages
+(page-hot-cold) end
+EOF
+pass;
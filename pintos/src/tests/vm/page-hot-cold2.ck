@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-hot-cold2) begin
+(page-hot-cold2) fill 64 hot pages
+(page-hot-cold2) stream through 640 cold pages
+(page-hot-cold2) check hot pages
+(page-hot-cold2) check cold pages
+(page-hot-cold2) end
+EOF
+pass;
@@ -0,0 +1,24 @@
+/* Runs 4 child-share processes at once, so that they map the
+   read-only pages of their executable from shared frames, under
+   enough memory pressure that those frames are evicted while
+   shared. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 4
+
+void
+test_main (void)
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK ((children[i] = exec ("child-share")) != -1,
+           "exec \"child-share\"");
+
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0x48, "wait for child %d", i);
+}
@@ -0,0 +1,72 @@
+/* Fills a 3 MB array, more than fits in memory, then copies its
+   first megabyte to a file and back, a page per read() or
+   write().  Most of those pages are in swap when the file system
+   copies into or out of them, so swap and file system requests
+   are in flight together.  Checks every byte of every page. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 768
+#define FILE_PAGES 256
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/* Returns the byte expected at offset OFS of page PAGE. */
+static char
+expected (size_t page, size_t ofs)
+{
+  return page * 7 + ofs;
+}
+
+/* Checks pages FIRST through LAST - 1 of BUF, in order. */
+static void
+check_pages (size_t first, size_t last)
+{
+  size_t page, ofs;
+
+  for (page = first; page < last; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      if (buf[page][ofs] != expected (page, ofs))
+        fail ("page %zu byte %zu is %02hhx, should be %02hhx",
+              page, ofs, buf[page][ofs], expected (page, ofs));
+}
+
+void
+test_main (void)
+{
+  const char *file_name = "swapped";
+  size_t page, ofs;
+  int fd;
+
+  msg ("fill %d pages", PAGE_CNT);
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      buf[page][ofs] = expected (page, ofs);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("write pages 0 through %d to \"%s\"", FILE_PAGES - 1, file_name);
+  for (page = 0; page < FILE_PAGES; page++)
+    if (write (fd, buf[page], PAGE_SIZE) != PAGE_SIZE)
+      fail ("write page %zu failed", page);
+
+  msg ("clear pages 0 through %d", FILE_PAGES - 1);
+  for (page = 0; page < FILE_PAGES; page++)
+    memset (buf[page], 0, PAGE_SIZE);
+  msg ("check pages %d through %d", FILE_PAGES, PAGE_CNT - 1);
+  check_pages (FILE_PAGES, PAGE_CNT);
+
+  msg ("read pages 0 through %d from \"%s\"", FILE_PAGES - 1, file_name);
+  seek (fd, 0);
+  for (page = 0; page < FILE_PAGES; page++)
+    if (read (fd, buf[page], PAGE_SIZE) != PAGE_SIZE)
+      fail ("read page %zu failed", page);
+  close (fd);
+
+  msg ("check all pages");
+  check_pages (0, PAGE_CNT);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-swap-file) begin
+(page-swap-file) fill 768 pages
+(page-swap-file) create "swapped"
+(page-swap-file) open "swapped"
+(page-swap-file) write pages 0 through 255 to "swapped"
+(page-swap-file) clear pages 0 through 255
+(page-swap-file) check pages 256 through 767
+(page-swap-file) read pages 0 through 255 from "swapped"
+(page-swap-file) check all pages
+(page-swap-file) end
+EOF
+pass;
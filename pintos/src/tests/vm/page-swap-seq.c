@@ -0,0 +1,49 @@
+/* Fills a 3 MB array, more than fits in memory, one page after
+   another, so that most of it is written to swap in clusters,
+   then reads it back twice in the same order, which swaps pages
+   back in with read-ahead, and checks every byte of every
+   page. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 768
+
+static char buf[PAGE_CNT][PAGE_SIZE];
+
+/* Returns the byte expected at offset OFS of page PAGE. */
+static char
+expected (size_t page, size_t ofs)
+{
+  return page * 7 + ofs;
+}
+
+/* Checks every page of BUF, in order. */
+static void
+check_pages (void)
+{
+  size_t page, ofs;
+
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      if (buf[page][ofs] != expected (page, ofs))
+        fail ("page %zu byte %zu is %02hhx, should be %02hhx",
+              page, ofs, buf[page][ofs], expected (page, ofs));
+}
+
+void
+test_main (void)
+{
+  size_t page, ofs;
+
+  msg ("fill %d pages", PAGE_CNT);
+  for (page = 0; page < PAGE_CNT; page++)
+    for (ofs = 0; ofs < PAGE_SIZE; ofs++)
+      buf[page][ofs] = expected (page, ofs);
+
+  msg ("check pages in order");
+  check_pages ();
+  msg ("check pages in order again");
+  check_pages ();
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-swap-seq) begin
+(page-swap-seq) fill 768 pages
+(page-swap-seq) check pages in order
+(page-swap-seq) check pages in order again
+(page-swap-seq) end
+EOF
+pass;
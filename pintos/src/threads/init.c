@@ -28,6 +28,7 @@
 #include "userprog/gdt.h"
 #include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/aio.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
 #else
@@ -36,6 +37,8 @@
 #ifdef FILESYS
 #include "devices/block.h"
 #include "devices/ide.h"
+#include "devices/ramdisk.h"
+#include "devices/stripe.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #include "filesys/inode.h"
@@ -122,11 +125,14 @@ main (void)
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
+  console_start ();
   timer_calibrate ();
 
 #ifdef FILESYS
   /* Initialize file system. */
   ide_init ();
+  ramdisk_init ();
+  stripe_init ();
   locate_block_devices ();
   filesys_init (format_filesys);
   thread_current()->cwd_inode = inode_open(ROOT_DIR_SECTOR);
@@ -134,6 +140,7 @@ main (void)
 
 #ifdef USERPROG
   swap_init();
+  aio_init ();
 #endif
 
   printf ("Boot complete.\n");
@@ -259,10 +266,29 @@ parse_options (char **argv)
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
+      else if (!strcmp (name, "-clock2"))
+        frame_two_handed = true;
 #endif
+      else if (!strcmp (name, "-dma"))
+        ide_dma = true;
+      else if (!strcmp (name, "-ramdisk"))
+        ramdisk_kb = atoi (value);
+      else if (!strcmp (name, "-stripe"))
+        stripe_members = value;
+      else if (!strcmp (name, "-stripe-chunk"))
+        stripe_chunk = atoi (value);
+      else if (!strcmp (name, "-iosched"))
+        {
+          if (value == NULL || !block_set_scheduler (value))
+            PANIC ("unknown I/O scheduler `%s'", value != NULL ? value : "");
+        }
 #endif
+      else if (!strcmp (name, "-serial-buf"))
+        serial_buf_size = atoi (value);
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
 #ifdef USERPROG
@@ -384,9 +410,17 @@ usage (void)
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
+          "  -clock2            Use two-handed CLOCK for page eviction.\n"
 #endif
+          "  -dma               Use bus-master DMA for IDE disks.\n"
+          "  -ramdisk=KB        Create a KB kB RAM disk named rd0.\n"
+          "  -stripe=DEV,...    Stripe devices DEV,... into a device named md0.\n"
+          "  -stripe-chunk=N    Use N-sector stripe chunks (default 16).\n"
+          "  -iosched=NAME      Use I/O scheduler NAME: noop, scan or deadline.\n"
 #endif
+          "  -serial-buf=BYTES  Use a BYTES-byte serial transmit queue.\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
+          "  -tickless          Use one-shot timer interrupts, not periodic ones.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
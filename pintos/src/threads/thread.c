@@ -35,9 +35,6 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* Stores sleeping threads. */
-static struct list wait_list;
-
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -112,7 +109,6 @@ thread_init (void)
   lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
-  list_init (&wait_list);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -174,19 +170,6 @@ thread_tick (int64_t total_ticks)
     
   }
 
-  /* Adds sleeping threads to ready_list if waiting time elapsed. */
-  enum intr_level old_level;
-  old_level = intr_disable();
-  struct list_elem *e = list_begin(&wait_list);
-  while (e != list_end(&wait_list)) {
-    struct thread *t = list_entry (e, struct thread, elem);
-    if (total_ticks >= t->tick_till_wait) {
-      e = list_remove(e);
-      thread_unblock(t);
-    } else break;
-  }
-  intr_set_level(old_level);
-
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
@@ -420,27 +403,6 @@ thread_yield (void)
   intr_set_level (old_level);
 }
 
-static bool 
-thread_cmp_wait_times (const struct list_elem *a, const struct list_elem *b, UNUSED void* aux)
-{
-  int64_t first = list_entry (a, struct thread, elem)->tick_till_wait;
-  int64_t second = list_entry (b, struct thread, elem)->tick_till_wait;
-  return first < second;
-}
-
-/*
- * Blocks current thread for wait_time ticks and
- * Puts it in wait list.
- * This function must be called with interrupts off.
- */
-void thread_sleep(int64_t wait_time) {
-  struct thread* curr = thread_current();
-  curr->status = THREAD_BLOCKED;
-  curr->tick_till_wait = wait_time;
-  list_insert_ordered(&wait_list, &(curr->elem), thread_cmp_wait_times, NULL);
-  schedule ();
-}
-
 /* Invoke function 'func' on all threads, passing along 'aux'.
    This function must be called with interrupts off. */
 void
@@ -594,7 +556,9 @@ idle (void *idle_started_ UNUSED)
     {
       /* Let someone else run. */
       intr_disable ();
+      timer_set_idle (false);
       thread_block ();
+      timer_set_idle (true);
 
       /* Re-enable interrupts and wait for the next one.
 
@@ -671,6 +635,7 @@ init_thread (struct thread *t, const char *name, int priority)
 #endif
 #ifdef FILESYS
   t->cwd_inode = NULL;
+  t->journal_op = false;
 #endif
 
   enum intr_level old_level = intr_disable ();  
@@ -96,9 +96,6 @@ struct thread
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 
-    /* Timer */
-    int64_t tick_till_wait;
-
     /* Donations */
     int saved_priority;
     struct list locks;                  /* Locks this thread holds */
@@ -127,9 +124,12 @@ struct thread
 
     struct hash mapping_table;
     int next_free_mapid;
+
+    struct aio_context *aio;            /* Asynchronous I/O ring, or NULL */
 #endif
 #ifdef FILESYS
     struct inode *cwd_inode;                  /* Current working directory inode. */
+    bool journal_op;                    /* Inside journal_begin()/journal_end()? */
 #endif
 
     /* Owned by thread.c. */
@@ -159,7 +159,6 @@ const char *thread_name (void);
 
 void thread_exit (void) NO_RETURN;
 void thread_yield (void);
-void thread_sleep(int64_t);
 
 /* Performs some operation on thread t, given auxiliary data AUX. */
 typedef void thread_action_func (struct thread *t, void *aux);
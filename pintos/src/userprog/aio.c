@@ -0,0 +1,287 @@
+#include "userprog/aio.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <string.h>
+#include "userprog/files.h"
+#include "userprog/syscall.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/page.h"
+
+/* Number of kernel worker threads. */
+#define AIO_WORKERS 4
+
+/* Largest buffer a single request may use, in pages.  Every page
+   stays pinned in memory while the request is in flight. */
+#define AIO_MAX_PAGES 16
+
+/* Per-process asynchronous I/O state. */
+struct aio_context
+  {
+    struct aio_ring *ring;              /* Kernel address of the shared ring. */
+    struct lock lock;                   /* Protects the completion queue. */
+    struct condition done;              /* Signaled on every completion. */
+    unsigned inflight;                  /* Requests handed to workers. */
+  };
+
+/* A request handed to the workers. */
+struct aio_request
+  {
+    struct list_elem elem;
+    struct aio_context *ctx;            /* Owning process's context. */
+    struct inode *inode;                /* File to read or write. */
+    int opcode;                         /* AIO_READ or AIO_WRITE. */
+    off_t offset;                       /* Offset in the file. */
+    uint8_t *buffer;                    /* User address of the buffer. */
+    unsigned length;                    /* Buffer length. */
+    unsigned user_data;                 /* Copied to the completion. */
+    int page_cnt;                       /* Number of pinned pages. */
+    struct page *pages[AIO_MAX_PAGES];  /* Pinned buffer pages. */
+  };
+
+static struct list requests;            /* Requests waiting for a worker. */
+static struct lock requests_lock;
+static struct semaphore requests_sema;  /* Counts REQUESTS. */
+
+static thread_func aio_worker;
+
+/* Starts the worker threads. */
+void aio_init (void) {
+  int i;
+
+  ASSERT (sizeof (struct aio_ring) <= PGSIZE);
+
+  list_init (&requests);
+  lock_init (&requests_lock);
+  sema_init (&requests_sema, 0);
+  for (i = 0; i < AIO_WORKERS; i++)
+    thread_create ("aio-worker", PRI_DEFAULT, aio_worker, NULL);
+}
+
+/* Maps a new, zeroed ring at RING, which must be a page-aligned
+   user address that is not mapped yet, and pins it in memory.
+   A process may only have one ring.  Returns true if
+   successful. */
+bool aio_map_ring (void *ring) {
+  struct thread *t = thread_current ();
+  struct page *page;
+
+  if (t->aio != NULL || ring == NULL || pg_ofs (ring) != 0
+      || !is_user_vaddr (ring)
+      || page_lookup (&t->sup_page_table, ring) != NULL)
+    return false;
+
+  struct aio_context *ctx = malloc (sizeof *ctx);
+  if (ctx == NULL)
+    return false;
+
+  page = page_allocate (ring, true, NULL);
+  if (page == NULL) {
+    free (ctx);
+    return false;
+  }
+  if (page_pin (ring, true) == NULL) {
+    page_remove (page);
+    page_deallocate (page);
+    free (ctx);
+    return false;
+  }
+  ctx->ring = (struct aio_ring *) page->frame->p_addr;
+  lock_init (&ctx->lock);
+  cond_init (&ctx->done);
+  ctx->inflight = 0;
+  t->aio = ctx;
+  return true;
+}
+
+/* Returns the number of completions the process has not
+   consumed yet.  CTX->lock must be held. */
+static unsigned cq_pending (struct aio_context *ctx) {
+  unsigned pending = ctx->ring->cq_tail - ctx->ring->cq_head;
+  return pending < AIO_CQ_ENTRIES ? pending : AIO_CQ_ENTRIES;
+}
+
+/* Posts a completion with RESULT for USER_DATA. */
+static void complete (struct aio_context *ctx, unsigned user_data, int result) {
+  lock_acquire (&ctx->lock);
+  struct aio_cqe *cqe = &ctx->ring->cq[ctx->ring->cq_tail % AIO_CQ_ENTRIES];
+  cqe->user_data = user_data;
+  cqe->result = result;
+  ctx->ring->cq_tail++;
+  ctx->inflight--;
+  cond_broadcast (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Turns SQE into a request, pinning its buffer.  Returns NULL if
+   the request is invalid, including if it would reach past the
+   largest file offset, 2**31 - 1. */
+static struct aio_request *prepare (struct aio_context *ctx, const struct aio_sqe *sqe) {
+  struct aio_request *req;
+  struct opened_file *of;
+  uint8_t *page_addr;
+
+  if (sqe->opcode != AIO_READ && sqe->opcode != AIO_WRITE)
+    return NULL;
+  of = sqe->fd < 2 ? NULL : files_lookup (sqe->fd);
+  if (of == NULL || of->is_dir)
+    return NULL;
+  if (sqe->offset > INT32_MAX || sqe->length > INT32_MAX - sqe->offset)
+    return NULL;
+
+  req = malloc (sizeof *req);
+  if (req == NULL)
+    return NULL;
+  req->ctx = ctx;
+  req->opcode = sqe->opcode;
+  req->offset = sqe->offset;
+  req->buffer = sqe->buffer;
+  req->length = sqe->length;
+  req->user_data = sqe->user_data;
+  req->page_cnt = 0;
+
+  if (req->length > 0) {
+    uint8_t *first = pg_round_down (req->buffer);
+    uint8_t *last = pg_round_down (req->buffer + req->length - 1);
+    if (last < first || (last - first) / PGSIZE >= AIO_MAX_PAGES
+        || !is_user_vaddr (last)) {
+      free (req);
+      return NULL;
+    }
+    for (page_addr = first; page_addr <= last; page_addr += PGSIZE) {
+      struct page *page = page_pin (page_addr, req->opcode == AIO_READ);
+      if (page == NULL) {
+        while (req->page_cnt > 0)
+          page_unpin (req->pages[--req->page_cnt]);
+        free (req);
+        return NULL;
+      }
+      req->pages[req->page_cnt++] = page;
+    }
+  }
+
+  req->inode = inode_reopen (file_get_inode (of->file));
+  return req;
+}
+
+/* Consumes up to TO_SUBMIT entries of the submission queue, then
+   waits until at least MIN_COMPLETE completions are pending or
+   nothing is in flight.  Submission stops early if the
+   completion queue could overflow.  Returns the number of entries
+   consumed, or -1 if the process has no ring. */
+int aio_enter (unsigned to_submit, unsigned min_complete) {
+  struct aio_context *ctx = thread_current ()->aio;
+  struct aio_ring *ring;
+  unsigned submitted = 0;
+
+  if (ctx == NULL)
+    return -1;
+  ring = ctx->ring;
+
+  lock_acquire (&ctx->lock);
+  while (submitted < to_submit && ring->sq_head != ring->sq_tail
+         && ctx->inflight + cq_pending (ctx) < AIO_CQ_ENTRIES) {
+    struct aio_sqe sqe = ring->sq[ring->sq_head % AIO_SQ_ENTRIES];
+    struct aio_request *req;
+
+    ring->sq_head++;
+    ctx->inflight++;
+    submitted++;
+    lock_release (&ctx->lock);
+
+    req = prepare (ctx, &sqe);
+    if (req == NULL)
+      complete (ctx, sqe.user_data, -1);
+    else {
+      lock_acquire (&requests_lock);
+      list_push_back (&requests, &req->elem);
+      lock_release (&requests_lock);
+      sema_up (&requests_sema);
+    }
+
+    lock_acquire (&ctx->lock);
+  }
+
+  while (cq_pending (ctx) < min_complete && ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+  return submitted;
+}
+
+/* Waits until none of the current process's requests is in
+   flight, so that their buffers can be unmapped. */
+void aio_drain (void) {
+  struct aio_context *ctx = thread_current ()->aio;
+
+  if (ctx == NULL)
+    return;
+  lock_acquire (&ctx->lock);
+  while (ctx->inflight > 0)
+    cond_wait (&ctx->done, &ctx->lock);
+  lock_release (&ctx->lock);
+}
+
+/* Waits for the current process's requests and frees its
+   context.  The ring page itself goes away with the
+   supplemental page table. */
+void aio_exit (void) {
+  struct thread *t = thread_current ();
+
+  aio_drain ();
+  free (t->aio);
+  t->aio = NULL;
+}
+
+/* Runs REQ and returns its result: the number of bytes
+   transferred. */
+static int execute (struct aio_request *req) {
+  unsigned done = 0;
+
+  if (req->opcode == AIO_WRITE)
+    journal_begin ();
+  while (done < req->length) {
+    uint8_t *uaddr = req->buffer + done;
+    int page_idx = (pg_round_down (uaddr) - pg_round_down (req->buffer)) / PGSIZE;
+    uint8_t *kaddr = req->pages[page_idx]->frame->p_addr + pg_ofs (uaddr);
+    unsigned page_left = PGSIZE - pg_ofs (uaddr);
+    unsigned chunk = req->length - done < page_left ? req->length - done : page_left;
+    off_t n;
+
+    if (req->opcode == AIO_READ)
+      n = inode_read_at (req->inode, kaddr, chunk, req->offset + done);
+    else
+      n = inode_write_at (req->inode, kaddr, chunk, req->offset + done);
+    done += n;
+    if ((unsigned) n < chunk)
+      break;
+  }
+  if (req->opcode == AIO_WRITE)
+    journal_end ();
+  return done;
+}
+
+/* Worker thread: runs queued requests one at a time. */
+static void aio_worker (void *aux UNUSED) {
+  for (;;) {
+    struct aio_request *req;
+    int result;
+
+    sema_down (&requests_sema);
+    lock_acquire (&requests_lock);
+    req = list_entry (list_pop_front (&requests), struct aio_request, elem);
+    lock_release (&requests_lock);
+
+    result = execute (req);
+    while (req->page_cnt > 0)
+      page_unpin (req->pages[--req->page_cnt]);
+    inode_close (req->inode);
+    complete (req->ctx, req->user_data, result);
+    free (req);
+  }
+}
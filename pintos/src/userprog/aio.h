@@ -0,0 +1,23 @@
+#ifndef USERPROG_AIO_H
+#define USERPROG_AIO_H
+
+#include <stdbool.h>
+
+/* Asynchronous I/O.
+
+   A process sets up one struct aio_ring (see lib/user/syscall.h)
+   in a page of its address space with aio_setup().  It queues
+   requests in the submission queue and hands them to the kernel
+   with aio_submit(), which pins the user buffers and passes the
+   requests to a pool of kernel worker threads.  The workers run
+   them through inode_read_at()/inode_write_at() and post results
+   to the completion queue, which the process can poll without
+   any system call. */
+
+void aio_init (void);
+bool aio_map_ring (void *ring);
+int aio_enter (unsigned to_submit, unsigned min_complete);
+void aio_drain (void);
+void aio_exit (void);
+
+#endif /* userprog/aio.h */
@@ -157,7 +157,7 @@ static void
 page_fault (struct intr_frame *f)
 {
   bool not_present;  /* True: not-present page, false: writing r/o page. */
-  bool write UNUSED; /* True: access was write, false: access was read. */
+  bool write;        /* True: access was write, false: access was read. */
   bool user;         /* True: access by user, false: access by kernel. */
   void *fault_addr;  /* Fault address. */
 
@@ -183,6 +183,12 @@ page_fault (struct intr_frame *f)
   user = (f->error_code & PF_U) != 0;
 
   if (!not_present) {
+    if (write && is_user_vaddr(fault_addr)) {
+      /* Write to a page shared copy-on-write since fork()? */
+      struct page *u_page = page_lookup(&thread_current()->sup_page_table, pg_round_down(fault_addr));
+      if (u_page != NULL && u_page->writable && page_unshare(u_page))
+        return;
+    }
     if (user || is_user_vaddr(fault_addr)) kill_process();
     kill(f);
   }
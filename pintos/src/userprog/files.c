@@ -50,6 +50,39 @@ void files_remove (int fd) {
   free(f);
 }
 
+/* 
+ * Copies PARENT's opened files into the current process, which
+ * fork() is creating from PARENT, under the same descriptors.
+ * Each copy is opened anew, at the same position for files.
+ * Returns false if memory is short.
+ */
+bool files_duplicate (struct thread *parent) {
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+
+  hash_first(&i, &parent->opened_files_table);
+  while (hash_next(&i)) {
+    struct opened_file *f = hash_entry (hash_cur(&i), struct opened_file, elem);
+    struct opened_file *copy = malloc(sizeof(struct opened_file));
+    if (copy == NULL) return false;
+    copy->descriptor = f->descriptor;
+    copy->is_dir = f->is_dir;
+    if (f->is_dir) {
+      copy->file = dir_reopen((struct dir*)f->file);
+    } else {
+      copy->file = file_reopen(f->file);
+      if (copy->file != NULL) file_seek(copy->file, file_tell(f->file));
+    }
+    if (copy->file == NULL) {
+      free(copy);
+      return false;
+    }
+    hash_insert(&t->opened_files_table, &copy->elem);
+  }
+  t->next_free_fd = parent->next_free_fd;
+  return true;
+}
+
 /* Returns a hash value for opened_file f. */
 unsigned opened_file_hash (const struct hash_elem *f_, void *aux UNUSED) {
   const struct opened_file *f = hash_entry (f_, struct opened_file, elem);
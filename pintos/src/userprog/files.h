@@ -4,6 +4,8 @@
 #include <hash.h>
 #include "filesys/file.h"
 
+struct thread;
+
 struct opened_file {
   int descriptor;
   void *file;
@@ -16,6 +18,7 @@ struct opened_file *files_lookup (int);
 bool files_is_directory (int);
 int files_get_inumber (int);
 void files_remove (int);
+bool files_duplicate (struct thread*);
 unsigned opened_file_hash (const struct hash_elem*, void* UNUSED);
 bool opened_file_less (const struct hash_elem*, const struct hash_elem*, void* UNUSED);
 void files_open_file_table_dest (struct hash_elem*, void*);
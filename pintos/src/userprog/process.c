@@ -10,10 +10,12 @@
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "userprog/files.h"
+#include "userprog/aio.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -27,6 +29,8 @@
 
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static void init_process (struct thread *);
 static bool load (void *argument_data, void (**eip) (void), void **esp);
 
 /* Starts a new thread running a user program loaded from
@@ -74,12 +78,7 @@ start_process (void *argument_data_)
   
   /* Initialize process */
   struct thread *t = thread_current();
-  t->exit_status = -1;
-  hash_init(&t->sup_page_table, page_hash, page_less, NULL);
-  hash_init(&t->opened_files_table, opened_file_hash, opened_file_less, NULL);
-  t->next_free_fd = 2;
-  hash_init(&t->mapping_table, mmap_hash, mmap_less, NULL);
-  t->next_free_mapid = 0;
+  init_process (t);
 
   /* Initialize interrupt frame and load executable. */
   memset (&if_, 0, sizeof if_);
@@ -110,6 +109,91 @@ start_process (void *argument_data_)
   NOT_REACHED ();
 }
 
+/* Creates a copy of the current process, whose user context is
+   saved in F, and returns the copy's thread id, or TID_ERROR if
+   it cannot be created.  The copy returns 0 from the fork()
+   system call.  Its address space starts out sharing the
+   current process's pages copy-on-write, so fork() costs time
+   in proportion to the size of the page tables, not of the
+   memory they map. */
+tid_t
+process_fork (struct intr_frame *f)
+{
+  struct process_fork_data fork_data;
+  tid_t tid;
+
+  fork_data.if_ = *f;
+  fork_data.parent = thread_current ();
+  sema_init (&fork_data.fork_signal, 0);
+  tid = thread_create (thread_current ()->name, PRI_DEFAULT, start_fork, &fork_data);
+  if (tid != TID_ERROR) {
+    /* We must not run until the copy is done. */
+    sema_down (&fork_data.fork_signal);
+    if (!fork_data.fork_success) tid = TID_ERROR;
+  }
+  return tid;
+}
+
+/* A thread function that copies the process that called fork()
+   and starts the copy running. */
+static void
+start_fork (void *fork_data_)
+{
+  struct process_fork_data *fork_data = fork_data_;
+  struct thread *parent = fork_data->parent;
+  struct intr_frame if_ = fork_data->if_;
+  bool success = false;
+
+  struct thread *t = thread_current ();
+  init_process (t);
+
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    goto done;
+  process_activate ();
+
+  t->exec_file = file_reopen (parent->exec_file);
+  if (t->exec_file == NULL)
+    goto done;
+  file_deny_write (t->exec_file);
+  t->saved_sp = parent->saved_sp;
+
+  success = (files_duplicate (parent)
+             && mmap_duplicate (parent)
+             && page_duplicate (parent));
+
+ done:
+  fork_data->fork_success = success;
+  if (!success) {
+    /* We are not on the parent's children list, so it will never
+       collect our status: don't wait for it to in thread_exit(). */
+    sema_up (&t->wait_for_parent);
+    sema_up (&fork_data->fork_signal);
+    thread_exit ();
+  }
+
+  list_push_back (&parent->children, &t->child_elem);
+  sema_up (&fork_data->fork_signal);
+
+  /* Return to user mode where the parent was, but with fork()
+     returning 0. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Initializes the process-specific parts of thread T. */
+static void
+init_process (struct thread *t)
+{
+  t->exit_status = -1;
+  hash_init(&t->sup_page_table, page_hash, page_less, NULL);
+  hash_init(&t->opened_files_table, opened_file_hash, opened_file_less, NULL);
+  t->next_free_fd = 2;
+  hash_init(&t->mapping_table, mmap_hash, mmap_less, NULL);
+  t->next_free_mapid = 0;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -163,6 +247,13 @@ process_exit (void)
     e = list_remove(&child->child_elem);
   }
 
+  /* Requests in flight still use our pages. */
+  aio_exit ();
+
+  /* Killed in the middle of a system call. */
+  if (cur->journal_op)
+    journal_end ();
+
   hash_destroy(&cur->mapping_table, mmap_mapping_table_dest);
   hash_destroy(&cur->opened_files_table, files_open_file_table_dest);
   hash_destroy(&cur->sup_page_table, page_suplemental_table_dest);
@@ -4,9 +4,11 @@
 #define BUFFER_SIZE 512
 
 #include "threads/thread.h"
+#include "threads/interrupt.h"
 
 
 tid_t process_execute (const char *file_name);
+tid_t process_fork (struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -21,4 +23,13 @@ struct process_argument_data
     struct thread* parent;
 };
 
+struct process_fork_data
+{
+    struct intr_frame if_;          /* User context of the parent. */
+
+    bool fork_success;
+    struct semaphore fork_signal;
+    struct thread* parent;
+};
+
 #endif /* userprog/process.h */
@@ -1,23 +1,31 @@
 #include "userprog/syscall.h"
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <console.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/block.h"
 #include "devices/shutdown.h"
+#include "devices/timer.h"
 
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "filesys/directory.h"
+#include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
 #include "devices/input.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
 #include "userprog/files.h"
+#include "userprog/aio.h"
 #include "vm/page.h"
 #include "vm/mmap.h"
 
-#define PIECE_SIZE 128  /* Size of chunk written on console. */
+#define PIECE_SIZE 128  /* Size of chunk copied to the console ring. */
 
 static void syscall_handler (struct intr_frame *);
 
@@ -40,6 +48,23 @@ static void mkdir_handler (struct intr_frame *f);
 static void chdir_handler (struct intr_frame *f);
 static void isdir_handler (struct intr_frame *f);
 static void inumber_handler (struct intr_frame *f);
+static void fsync_handler (struct intr_frame *f);
+static void copy_file_range_handler (struct intr_frame *f);
+static void pread_handler (struct intr_frame *f);
+static void pwrite_handler (struct intr_frame *f);
+static void readv_handler (struct intr_frame *f);
+static void writev_handler (struct intr_frame *f);
+static void aio_setup_handler (struct intr_frame *f);
+static void aio_submit_handler (struct intr_frame *f);
+static void fallocate_handler (struct intr_frame *f);
+static void ftruncate_handler (struct intr_frame *f);
+static void fadvise_handler (struct intr_frame *f);
+static void blockstats_handler (struct intr_frame *f);
+static void clock_gettime_handler (struct intr_frame *f);
+static void fork_handler (struct intr_frame *f);
+
+static int read_helper (int fd, void *buffer, unsigned size);
+static int write_helper (int fd, const void *buffer, unsigned size);
 
 static void exit_helper(int status);
 
@@ -94,6 +119,21 @@ syscall_handler (struct intr_frame *f)
   else if (syscall_num == SYS_EXIT) exit_handler(f);
   else if (syscall_num == SYS_ISDIR) isdir_handler(f);
   else if (syscall_num == SYS_INUMBER) inumber_handler(f);
+  else if (syscall_num == SYS_FSYNC) fsync_handler(f);
+  else if (syscall_num == SYS_SYNC) filesys_sync();
+  else if (syscall_num == SYS_COPY_FILE_RANGE) copy_file_range_handler(f);
+  else if (syscall_num == SYS_PREAD) pread_handler(f);
+  else if (syscall_num == SYS_PWRITE) pwrite_handler(f);
+  else if (syscall_num == SYS_READV) readv_handler(f);
+  else if (syscall_num == SYS_WRITEV) writev_handler(f);
+  else if (syscall_num == SYS_AIO_SETUP) aio_setup_handler(f);
+  else if (syscall_num == SYS_AIO_SUBMIT) aio_submit_handler(f);
+  else if (syscall_num == SYS_FALLOCATE) fallocate_handler(f);
+  else if (syscall_num == SYS_FTRUNCATE) ftruncate_handler(f);
+  else if (syscall_num == SYS_FADVISE) fadvise_handler(f);
+  else if (syscall_num == SYS_BLOCKSTATS) blockstats_handler(f);
+  else if (syscall_num == SYS_CLOCK_GETTIME) clock_gettime_handler(f);
+  else if (syscall_num == SYS_FORK) fork_handler(f);
   else if (syscall_num == SYS_HALT) shutdown_power_off();
   else if (syscall_num == SYS_PRACTICE) {
     if (!is_valid_ptr(f->esp, sizeof(uint32_t) + sizeof(int))) exit_helper(-1);
@@ -140,24 +180,37 @@ write_handler (struct intr_frame *f)
 
   if (!is_valid_ptr(buffer, size) || fd < 0) exit_helper(-1);
 
+  if (fd != STDOUT_FILENO) journal_begin ();
+  f->eax = write_helper(fd, buffer, size);
+  if (fd != STDOUT_FILENO) journal_end ();
+}
+
+/* Writes SIZE bytes from BUFFER to FD at its current position.
+   FD and BUFFER must already be validated, and a write to a file
+   must be inside a journal operation. */
+static int
+write_helper (int fd, const void *buffer, unsigned size)
+{
   if (fd == STDOUT_FILENO) {
-    char* ptr = (char*)buffer;
-    unsigned size_copy = size;
-    while (size >= PIECE_SIZE) {
-      putbuf(ptr, PIECE_SIZE);
-      size -= PIECE_SIZE;
-      ptr += PIECE_SIZE;
+    /* Copy to the kernel first, so that no page fault happens
+       while the console ring is locked. */
+    char piece[PIECE_SIZE];
+    const char* ptr = buffer;
+    unsigned left = size;
+    while (left > 0) {
+      unsigned n = left < PIECE_SIZE ? left : PIECE_SIZE;
+      memcpy(piece, ptr, n);
+      console_write_async(piece, n);
+      left -= n;
+      ptr += n;
     }
-    putbuf(ptr, size);
-    f->eax = size_copy;
+    return size;
   } else {
     struct opened_file *of = files_lookup(fd);
-    if (of->is_dir) f->eax = -1;
-    else {
-      struct file* file = of->file;
-      if (file == NULL) exit_helper(-1);
-      f->eax = file_write(file, buffer, size);
-    }
+    if (of->is_dir) return -1;
+    struct file* file = of->file;
+    if (file == NULL) exit_helper(-1);
+    return file_write(file, buffer, size);
   }
 }
 
@@ -179,21 +232,25 @@ read_handler (struct intr_frame *f)
   }
   if (!is_valid_ptr(buffer, size)) exit_helper(-1);
 
+  f->eax = read_helper(fd, buffer, size);
+}
+
+/* Reads SIZE bytes from FD at its current position into BUFFER.
+   FD and BUFFER must already be validated. */
+static int
+read_helper (int fd, void *buffer, unsigned size)
+{
   if (fd == STDIN_FILENO) {
     unsigned i;
     for(i = 0; i < size; i++)
       ((uint8_t*)buffer)[i] = input_getc();
-    f->eax = size;
+    return size;
   } else {
     struct opened_file *of = files_lookup(fd);
-    if (of->is_dir) f->eax = -1;
-    else {
-      struct file* file = of->file;
-      if (file == NULL) f->eax = -1;
-      else {
-        f->eax = file_read(file, buffer, size);
-      }
-    }
+    if (of->is_dir) return -1;
+    struct file* file = of->file;
+    if (file == NULL) return -1;
+    return file_read(file, buffer, size);
   }
 }
 
@@ -298,7 +355,9 @@ close_handler (struct intr_frame* f)
 
   if (fd < 0) return;
 
+  journal_begin ();
   files_remove(fd);
+  journal_end ();
 }
 
 static void 
@@ -314,7 +373,9 @@ create_handler (struct intr_frame* f)
 
   if (!is_valid_string(file_name)) exit_helper(-1);
 
+  journal_begin ();
   f->eax = filesys_create(file_name, initial_size, false);
+  journal_end ();
 }
 
 static void 
@@ -329,7 +390,9 @@ remove_handler (struct intr_frame* f)
 
   if (!is_valid_string(file_name)) exit_helper(-1);
 
+  journal_begin ();
   f->eax = filesys_remove(file_name);
+  journal_end ();
 }
 
 static void
@@ -432,6 +495,7 @@ static void munmap_handler (struct intr_frame *f)
   struct mmap *m = mmap_lookup(&curr->mapping_table, mapping);
   if (m == NULL) return;
 
+  aio_drain();
   mmap_remove(m);
   mmap_deallocate(m);
 }
@@ -446,7 +510,9 @@ static void mkdir_handler (struct intr_frame *f)
   const char *path = (const char *) args[1];
   if (!is_valid_string (path)) exit_helper (-1);
 
+  journal_begin ();
   f->eax = filesys_create (path, 0, true);
+  journal_end ();
 }
 
 static void chdir_handler (struct intr_frame *f)
@@ -505,4 +571,286 @@ static void readdir_handler (struct intr_frame *f) {
   } else {
     f->eax = dir_readdir(of->file, name);
   }
-}
\ No newline at end of file
+}
+
+static void fsync_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL) {
+    f->eax = false;
+    return;
+  }
+  if (of->is_dir) inode_sync(dir_get_inode(of->file));
+  else inode_sync(file_get_inode(of->file));
+  f->eax = true;
+}
+
+static void copy_file_range_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(int) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd_in = args[1];
+  int fd_out = args[2];
+  unsigned length = args[3];
+
+  struct opened_file *in = fd_in < 0 ? NULL : files_lookup(fd_in);
+  struct opened_file *out = fd_out < 0 ? NULL : files_lookup(fd_out);
+  if (in == NULL || out == NULL || in->is_dir || out->is_dir) {
+    f->eax = -1;
+    return;
+  }
+
+  journal_begin ();
+  f->eax = file_copy(out->file, in->file, length);
+  journal_end ();
+}
+
+static void pread_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(void*) + sizeof(unsigned) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  void* buffer = (void*)args[2];
+  unsigned size = args[3];
+  unsigned offset = args[4];
+
+  if (!is_valid_ptr(buffer, size)) exit_helper(-1);
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL || of->is_dir || offset > INT32_MAX || size > INT32_MAX - offset) {
+    f->eax = -1;
+    return;
+  }
+  f->eax = file_read_at(of->file, buffer, size, offset);
+}
+
+static void pwrite_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(void*) + sizeof(unsigned) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  const void* buffer = (void*)args[2];
+  unsigned size = args[3];
+  unsigned offset = args[4];
+
+  if (!is_valid_ptr(buffer, size)) exit_helper(-1);
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL || of->is_dir || offset > INT32_MAX || size > INT32_MAX - offset) {
+    f->eax = -1;
+    return;
+  }
+  journal_begin ();
+  f->eax = file_write_at(of->file, buffer, size, offset);
+  journal_end ();
+}
+
+/* Checks the IOVCNT entries of IOV and the buffers they point to,
+   killing the process if any of them is invalid.  IOVCNT is
+   bounded first, so that the size of IOV can't overflow. */
+static void
+check_iovec (const struct iovec *iov, int iovcnt)
+{
+  int i;
+  if (iovcnt < 0 || iovcnt > IOV_MAX || !is_valid_ptr(iov, iovcnt * sizeof *iov)) exit_helper(-1);
+  for (i = 0; i < iovcnt; i++)
+    if (!is_valid_ptr(iov[i].iov_base, iov[i].iov_len)) exit_helper(-1);
+}
+
+static void readv_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(struct iovec*) + sizeof(int);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  const struct iovec *iov = (const struct iovec*)args[2];
+  int iovcnt = args[3];
+
+  check_iovec(iov, iovcnt);
+  if (fd < 0 || (fd != STDIN_FILENO && files_lookup(fd) == NULL)) {
+    f->eax = -1;
+    return;
+  }
+
+  /* Scatter, stopping at the first short read. */
+  int total = 0, i;
+  for (i = 0; i < iovcnt; i++) {
+    int bytes_read = read_helper(fd, iov[i].iov_base, iov[i].iov_len);
+    if (bytes_read < 0) {
+      f->eax = i == 0 ? -1 : total;
+      return;
+    }
+    total += bytes_read;
+    if ((size_t) bytes_read < iov[i].iov_len) break;
+  }
+  f->eax = total;
+}
+
+static void writev_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(struct iovec*) + sizeof(int);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  const struct iovec *iov = (const struct iovec*)args[2];
+  int iovcnt = args[3];
+
+  check_iovec(iov, iovcnt);
+  if (fd < 0 || (fd != STDOUT_FILENO && files_lookup(fd) == NULL)) {
+    f->eax = -1;
+    return;
+  }
+
+  /* Gather, stopping at the first short write.  One journal
+     operation covers the whole call, so its metadata changes
+     commit together, as a single write()'s do.  File data is not
+     journaled, so a crash can still leave part of it written. */
+  int total = 0, i;
+  if (fd != STDOUT_FILENO) journal_begin ();
+  for (i = 0; i < iovcnt; i++) {
+    int bytes_written = write_helper(fd, iov[i].iov_base, iov[i].iov_len);
+    if (bytes_written < 0) {
+      if (i == 0) total = -1;
+      break;
+    }
+    total += bytes_written;
+    if ((size_t) bytes_written < iov[i].iov_len) break;
+  }
+  if (fd != STDOUT_FILENO) journal_end ();
+  f->eax = total;
+}
+
+static void aio_setup_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(void*);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  void *ring = (void*)args[1];
+
+  f->eax = aio_map_ring(ring);
+}
+
+static void aio_submit_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(unsigned) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  unsigned to_submit = args[1];
+  unsigned min_complete = args[2];
+
+  f->eax = aio_enter(to_submit, min_complete);
+}
+
+static void fallocate_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(unsigned) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  off_t offset = args[2];
+  off_t length = args[3];
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL || of->is_dir || offset < 0 || length < 0 || offset > INT32_MAX - length) {
+    f->eax = false;
+    return;
+  }
+  journal_begin ();
+  f->eax = inode_allocate(file_get_inode(of->file), offset, length);
+  journal_end ();
+}
+
+static void ftruncate_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(unsigned);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  off_t length = args[2];
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL || of->is_dir || length < 0) {
+    f->eax = false;
+    return;
+  }
+  journal_begin ();
+  f->eax = inode_truncate(file_get_inode(of->file), length);
+  journal_end ();
+}
+
+static void fadvise_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int) + sizeof(unsigned) + sizeof(unsigned) + sizeof(int);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int fd = args[1];
+  off_t offset = args[2];
+  off_t length = args[3];
+  int advice = args[4];
+
+  struct opened_file *of = fd < 0 ? NULL : files_lookup(fd);
+  if (of == NULL || of->is_dir || offset < 0 || length < 0 || offset > INT32_MAX - length
+      || advice < FADV_NORMAL || advice > FADV_DONTNEED) {
+    f->eax = false;
+    return;
+  }
+  inode_advise(file_get_inode(of->file), offset, length, advice);
+  f->eax = true;
+}
+
+static void blockstats_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(char*) + sizeof(struct block_stats*);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  const char *name = (const char*) args[1];
+  struct block_stats *stats = (struct block_stats*) args[2];
+
+  if (!is_valid_string(name) || !is_valid_ptr(stats, sizeof *stats)) exit_helper(-1);
+
+  struct block *block = block_get_by_name(name);
+  if (block == NULL) {
+    f->eax = false;
+    return;
+  }
+  struct block_stats copy;  /* Don't fault on STATS with interrupts off. */
+  block_get_stats(block, &copy);
+  memcpy(stats, &copy, sizeof copy);
+  f->eax = true;
+}
+
+static void clock_gettime_handler (struct intr_frame *f) {
+  uint32_t* args = ((uint32_t*) f->esp);
+  int arguments_size = sizeof(uint32_t) + sizeof(int64_t*);
+  if (!is_valid_ptr(args, arguments_size)) exit_helper(-1);
+
+  /* Arguments */
+  int64_t *ns = (int64_t*) args[1];
+
+  if (!is_valid_ptr(ns, sizeof *ns)) exit_helper(-1);
+  *ns = timer_ns();
+}
+
+static void fork_handler (struct intr_frame *f) {
+  f->eax = process_fork(f);
+}
@@ -1,77 +1,306 @@
 #include "vm/frame.h"
+#include "vm/share.h"
 #include "threads/malloc.h"
 #include "userprog/pagedir.h"
 
+/* Number of frames between the two hands of two-handed CLOCK,
+   at most. */
+#define HAND_SPREAD 64
+
+/* Most pages written to swap together, and most frames looked at
+   to find them. */
+#define SWAP_CLUSTER 8
+#define CLUSTER_SCAN 32
+
 struct list frame_table;
 struct lock frame_lock;
 
+/* If false (default), eviction uses CLOCK.  If true, it uses
+   two-handed CLOCK.  Controlled by kernel command-line option
+   "-clock2". */
+bool frame_two_handed;
+
+/* The frame table is treated as a circle.  The clock hand is the
+   next frame eviction looks at, and it stays put between calls.
+   Two-handed CLOCK also has a front hand, which clears accessed
+   bits up to HAND_SPREAD frames ahead of it, so that a page
+   survives only if it is used within that window.  The window is
+   kept at half the table when that is smaller.  Null when the
+   table is empty. */
+static struct list_elem *hand;
+static struct list_elem *front_hand;
+static size_t frame_cnt;
+
+/* Frames evicted along with another one, waiting to be reused.
+   Not in the frame table. */
+static struct list free_frames;
+
 void frame_init() {
   list_init(&frame_table);
+  list_init(&free_frames);
   lock_init(&frame_lock);
+  share_init();
 }
 
 static struct frame* eviction(void);
+static struct list_elem* clock_next(struct list_elem *);
+static void insert_frame(struct frame *);
+static void remove_frame(struct frame *);
+static void place_front_hand(void);
+static struct frame* allocate(struct page *, bool may_evict);
 
+/* Returns a frame for U_PAGE, evicting another page if memory is
+   full. */
 struct frame* frame_allocate (struct page *u_page) {
+  return allocate(u_page, true);
+}
+
+/* Returns a frame for U_PAGE if one is free without evicting
+   anything, otherwise a null pointer. */
+struct frame* frame_allocate_free (struct page *u_page) {
+  return allocate(u_page, false);
+}
+
+/* Takes a page from the user pool for U_PAGE, or a frame left
+   over by evict_cluster(), or else, if MAY_EVICT, evicts one. */
+static struct frame* allocate(struct page *u_page, bool may_evict) {
   struct frame *frame = NULL;
   void *k_page = palloc_get_page (PAL_USER);
   if (k_page == NULL) {
     lock_acquire(&frame_lock);
-    frame = eviction();
+    if (!list_empty(&free_frames)) {
+      frame = list_entry(list_pop_front(&free_frames), struct frame, elem);
+      insert_frame(frame);
+    } else if (may_evict) frame = eviction();
+    else {
+      lock_release(&frame_lock);
+      return NULL;
+    }
     frame->u_page = u_page;
     frame->pinned = true;
+    frame->pin_cnt = 0;
     lock_release(&frame_lock);
+    if (frame->swapping) { /* Other faults may proceed while the old contents go out. */
+      block_wait(&frame->swap_io);
+      frame->swapping = false;
+    }
   } else {
     frame = malloc(sizeof(struct frame));
     if (frame == NULL) return NULL;
     
     frame->p_addr = k_page;
     frame->pinned = false;
+    frame->pin_cnt = 0;
+    frame->swapping = false;
+    frame->share = NULL;
     frame->u_page = u_page;
 
     lock_acquire(&frame_lock);
-    list_push_back(&frame_table, &frame->elem);
+    insert_frame(frame);
     lock_release(&frame_lock);
   }
   return frame;
 }
 
+/* Frees FRAME.  Memory is no longer short then, so the frames
+   evict_cluster() left on FREE_FRAMES go back to the user pool
+   too, once their pages are written out. */
 void frame_deallocate (struct frame *frame) {
+  struct list spare;
   palloc_free_page(frame->p_addr);
 
+  list_init(&spare);
   lock_acquire(&frame_lock);
-  list_remove(&frame->elem);
+  remove_frame(frame);
+  while (!list_empty(&free_frames)) list_push_back(&spare, list_pop_front(&free_frames));
   lock_release(&frame_lock);
 
   free(frame);
+  while (!list_empty(&spare)) {
+    frame = list_entry(list_pop_front(&spare), struct frame, elem);
+    if (frame->swapping) block_wait(&frame->swap_io);
+    palloc_free_page(frame->p_addr);
+    free(frame);
+  }
 }
 
+/* Adds FRAME to the frame table just behind the hand, so that it
+   is looked at last. */
+static void insert_frame(struct frame *frame) {
+  if (hand == NULL) {
+    list_push_back(&frame_table, &frame->elem);
+    hand = &frame->elem;
+  } else list_insert(hand, &frame->elem);
+  frame_cnt++;
+  place_front_hand();
+}
+
+/* Removes FRAME from the frame table. */
+static void remove_frame(struct frame *frame) {
+  if (hand == &frame->elem) hand = clock_next(hand);
+  if (front_hand == &frame->elem) front_hand = clock_next(front_hand);
+  list_remove(&frame->elem);
+  if (--frame_cnt == 0) hand = front_hand = NULL;
+  else place_front_hand();
+}
+
+/* Puts the front hand HAND_SPREAD frames ahead of the hand, or
+   half the table if that is less, in two-handed mode. */
+static void place_front_hand(void) {
+  size_t spread = frame_cnt / 2 < HAND_SPREAD ? frame_cnt / 2 : HAND_SPREAD;
+  if (!frame_two_handed) return;
+  front_hand = hand;
+  while (spread-- > 0) front_hand = clock_next(front_hand);
+}
+
+
+/* Returns the frame after E in the circular frame table. */
+static struct list_elem* clock_next(struct list_elem *e) {
+  e = list_next(e);
+  return e != list_end(&frame_table) ? e : list_begin(&frame_table);
+}
+
+/* Returns true if FRAME's page was accessed, clearing the
+   accessed bit if CLEAR is true. */
+static bool frame_accessed(struct frame *frame, bool clear) {
+  if (frame->share != NULL) return share_accessed(frame, clear);
+  struct page *u_page = frame->u_page;
+  bool accessed = pagedir_is_accessed(u_page->pagedir, u_page->v_addr);
+  if (clear) pagedir_set_accessed(u_page->pagedir, u_page->v_addr, false);
+  return accessed;
+}
+
+/* Returns true if evicting FRAME means writing its page to
+   swap. */
+static bool needs_swap(struct frame *frame) {
+  struct page *u_page = frame->u_page;
+  if (frame->share != NULL || (u_page->file_info != NULL && u_page->file_info->mapped))
+    return false;
+  return u_page->dirtied || pagedir_is_dirty(u_page->pagedir, u_page->v_addr);
+}
 
+/* Takes FRAME away from its page and starts writing the page to
+   SLOT. */
+static void swap_evict(struct frame *frame, swap_slot_t slot) {
+  struct page *u_page = frame->u_page;
+  u_page->frame = NULL;
+  u_page->dirtied = true;
+  pagedir_clear_page(u_page->pagedir, u_page->v_addr);
+  u_page->swap_slot = slot;
+  swap_write(slot, frame->p_addr, &frame->swap_io);
+  frame->swapping = true;
+}
+
+/* Returns true if page A goes before page B in swap: pages of a
+   process are kept in address order. */
+static bool swap_before(const struct page *a, const struct page *b) {
+  if (a->pagedir != b->pagedir) return a->pagedir < b->pagedir;
+  return a->v_addr < b->v_addr;
+}
+
+static struct frame* clock_step(void);
+
+/* Evicts FIRST, which needs_swap(), along with up to
+   SWAP_CLUSTER - 1 more such frames that the hand finds next, and
+   writes all their pages to a run of consecutive swap slots in
+   address order.  Writing them together keeps the disk busy with
+   one long transfer instead of many short ones, and lays a
+   process's pages out so that page_load() can read neighbours
+   back in one go.  The other frames go to FREE_FRAMES. */
+static void evict_cluster(struct frame *first) {
+  struct frame *cluster[SWAP_CLUSTER];
+  size_t n = 1, i, j;
+
+  /* Fewer steps than frames, so the hand doesn't get back around
+     to FIRST. */
+  size_t scan = frame_cnt - 1 < CLUSTER_SCAN ? frame_cnt - 1 : CLUSTER_SCAN;
+  cluster[0] = first;
+  while (n < SWAP_CLUSTER && scan-- > 0) {
+    struct frame *frame = clock_step();
+    if (frame != NULL && needs_swap(frame)) cluster[n++] = frame;
+  }
+
+  for (i = 1; i < n; i++) { /* Insertion sort. */
+    struct frame *frame = cluster[i];
+    for (j = i; j > 0 && swap_before(frame->u_page, cluster[j - 1]->u_page); j--)
+      cluster[j] = cluster[j - 1];
+    cluster[j] = frame;
+  }
+
+  for (i = 0; i < n; ) {
+    size_t cnt = n - i;
+    swap_slot_t slot = swap_alloc(&cnt);
+    for (j = 0; j < cnt; j++) swap_evict(cluster[i + j], slot + j);
+    i += cnt;
+  }
+
+  for (i = 0; i < n; i++)
+    if (cluster[i] != first) {
+      remove_frame(cluster[i]);
+      cluster[i]->u_page = NULL;
+      list_push_back(&free_frames, &cluster[i]->elem);
+    }
+}
+
+/* Takes FRAME away from its page, writing the page back to its
+   file or starting to write it to swap.  A page that is still as
+   it was loaded from its executable, or zero-filled, is just
+   dropped, and page_load() recreates it on the next fault.
+   Swapping evicts other frames too; see evict_cluster(). */
+static void evict(struct frame *frame) {
+  if (frame->share != NULL) { /* Unmap it everywhere. */
+    swap_slot_t slot = -1;
+    if (share_is_copy_on_write(frame) && share_is_dirty(frame)) {
+      slot = swap_out_async(frame->p_addr, &frame->swap_io);
+      frame->swapping = true;
+    }
+    share_evict(frame, slot);
+    return;
+  }
+  if (needs_swap(frame)) {
+    evict_cluster(frame);
+    return;
+  }
+  struct page *u_page = frame->u_page;
+  u_page->frame = NULL;
+  bool is_dirty = pagedir_is_dirty(u_page->pagedir, u_page->v_addr);
+  pagedir_clear_page(u_page->pagedir, u_page->v_addr); // Remove page from page directory
+  if (u_page->file_info != NULL && u_page->file_info->mapped) { /* Check if it's mapped file page */
+    if (is_dirty) { /* write back to file or discard page */
+      file_seek(u_page->file_info->file, u_page->file_info->offset);
+      file_write(u_page->file_info->file, frame->p_addr, u_page->file_info->length);
+    }
+  }
+}
+
+/* Picks a frame to reuse and evicts its page.  FRAME_LOCK must
+   be held. */
 static struct frame*
 eviction() 
 { 
+  ASSERT(hand != NULL);
+
   while(true) {
-    struct list_elem *e = list_begin(&frame_table);
-    while (e != list_end(&frame_table)) {
-      struct frame *frame = list_entry (e, struct frame, elem);
-      struct page *u_page = frame->u_page;
-      if (!pagedir_is_accessed(u_page->pagedir, u_page->v_addr) && !frame->pinned) { // Swap out
-        u_page->frame = NULL;
-        bool is_dirty = pagedir_is_dirty(u_page->pagedir, u_page->v_addr);
-        pagedir_clear_page(u_page->pagedir, u_page->v_addr); // Remove page from page directory
-        if (u_page->file_info != NULL && u_page->file_info->mapped) { /* Check if it's mapped file page */
-          if (is_dirty) { /* write back to file or discard page */
-            file_seek(u_page->file_info->file, u_page->file_info->offset);
-            file_write(u_page->file_info->file, frame->p_addr, u_page->file_info->length);
-          }
-        } else { /* Swap */
-          u_page->swap_slot = swap_out(frame->p_addr);
-        }
-        return frame;
-      }
-      pagedir_set_accessed(u_page->pagedir, u_page->v_addr, false);
-      e = list_next(e);
+    struct frame *frame = clock_step();
+    if (frame != NULL) {
+      evict(frame);
+      return frame;
     }
   }
   NOT_REACHED();
-}
\ No newline at end of file
+}
+
+/* Advances the hand by one frame.  Returns that frame if it may
+   be evicted, otherwise a null pointer. */
+static struct frame* clock_step(void) {
+  struct frame *frame = list_entry (hand, struct frame, elem);
+  bool accessed;
+  if (frame_two_handed) {
+    frame_accessed(list_entry (front_hand, struct frame, elem), true);
+    front_hand = clock_next(front_hand);
+    accessed = frame_accessed(frame, false);
+  } else accessed = frame_accessed(frame, true);
+  hand = clock_next(hand);
+
+  return !accessed && !frame->pinned && frame->pin_cnt == 0 ? frame : NULL;
+}
@@ -2,16 +2,22 @@
 #define VM_FRAME_H
 
 #include "vm/page.h"
+#include "devices/block.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 
 struct lock frame_lock;
+extern bool frame_two_handed;
 
 struct frame {
   uint8_t *p_addr; /* Physical address of the page */
   struct page *u_page; /* Pointer to user suplemental page */
   bool pinned;
+  int pin_cnt; /* Pins held by in-flight asynchronous I/O */
+  bool swapping; /* Swap-out write in SWAP_IO still in flight */
+  struct block_request swap_io;
+  struct share *share; /* Non-null if shared by several processes; U_PAGE is then stale */
 
   struct list_elem elem;
 };
@@ -19,6 +25,7 @@ struct frame {
 
 void frame_init(void);
 struct frame* frame_allocate (struct page*);
+struct frame* frame_allocate_free (struct page*);
 void frame_deallocate (struct frame*);
 
 
@@ -42,6 +42,50 @@ void mmap_deallocate (struct mmap *m) {
   free(m);
 }
 
+/*
+ * Copies PARENT's memory mappings, and their pages, into the
+ * current process, which fork() is creating from PARENT.  Each
+ * copy maps the file through a file of its own and reads it on
+ * demand, so PARENT's dirty pages are written back first.
+ * PARENT must be blocked.  Returns false if memory is short.
+ */
+bool mmap_duplicate (struct thread *parent) {
+  struct thread *t = thread_current ();
+  struct hash_iterator i;
+
+  hash_first(&i, &parent->mapping_table);
+  while (hash_next(&i)) {
+    struct mmap *m = hash_entry (hash_cur(&i), struct mmap, elem);
+    struct mmap *copy = malloc(sizeof(struct mmap));
+    if (copy == NULL) return false;
+    copy->mapping = m->mapping;
+    copy->file = file_reopen(m->file);
+    if (copy->file == NULL) {
+      free(copy);
+      return false;
+    }
+    copy->start_addr = m->start_addr;
+    copy->end_addr = m->start_addr;
+    hash_insert(&t->mapping_table, &copy->elem);
+
+    uint8_t *page_addr;
+    for (page_addr = m->start_addr; page_addr < m->end_addr; page_addr += PGSIZE) {
+      struct page *page = page_lookup(&parent->sup_page_table, page_addr);
+      ASSERT (page != NULL && page->file_info != NULL);
+      struct file_info *file_info = malloc(sizeof(struct file_info));
+      if (file_info == NULL) return false;
+      *file_info = *page->file_info;
+      file_info->file = copy->file;
+
+      page_write_back(page);
+      page_allocate(page_addr, page->writable, file_info);
+      copy->end_addr = page_addr + PGSIZE;
+    }
+  }
+  t->next_free_mapid = parent->next_free_mapid;
+  return true;
+}
+
 void mmap_remove (struct mmap *m) {
   hash_delete(&thread_current()->mapping_table, &m->elem);
 }
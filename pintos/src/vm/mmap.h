@@ -6,6 +6,8 @@
 #include "filesys/file.h"
 #include "lib/user/syscall.h"
 
+struct thread;
+
 
 struct mmap {
     mapid_t mapping;
@@ -19,6 +21,7 @@ struct mmap {
 
 void* mmap_allocate (struct file*, uint8_t*);
 void mmap_deallocate (struct mmap*);
+bool mmap_duplicate (struct thread*);
 void mmap_remove (struct mmap*);
 unsigned mmap_hash (const struct hash_elem*, void* UNUSED);
 bool mmap_less (const struct hash_elem*, const struct hash_elem*, void* UNUSED);
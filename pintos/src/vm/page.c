@@ -1,10 +1,14 @@
 #include "vm/page.h"
+#include "vm/share.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include <string.h>
 #include "threads/malloc.h"
 #include "userprog/pagedir.h"
 
+/* Most pages page_load() reads from swap at once. */
+#define SWAP_READAHEAD 8
+
 /* 
  * Allocates suplemental page and adds it to suplemental page table.
  * returns NULL if allocations failed.
@@ -22,6 +26,7 @@ struct page *page_allocate (uint8_t *v_addr, bool writable, struct file_info *fi
   page->writable = writable;
   page->file_info = file_info;
   page->swap_slot = -1;
+  page->dirtied = false;
 
   hash_insert(&curr->sup_page_table, &page->elem);
   return page;
@@ -35,8 +40,14 @@ struct page *page_allocate (uint8_t *v_addr, bool writable, struct file_info *fi
  */
 void page_deallocate (struct page *page) {
   pagedir_clear_page(page->pagedir, page->v_addr);
-  if (page->frame != NULL)
-    frame_deallocate(page->frame);
+  lock_acquire(&frame_lock);
+  struct frame *frame = page->frame;
+  bool last = frame != NULL && (frame->share == NULL || share_detach(page));
+  if (last) frame->pinned = true; /* Eviction must not pick it before it is freed. */
+  lock_release(&frame_lock);
+  if (last) frame_deallocate(frame);
+  if (page->swap_slot != -1)
+    swap_free(page->swap_slot);
   if (page->file_info != NULL)
     free(page->file_info);
   free(page);
@@ -108,6 +119,64 @@ install_page (void *upage, void *kpage, bool writable)
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
 
+/*
+ * Reads PAGE, whose frame is allocated and pinned, back from swap,
+ * along with up to SWAP_READAHEAD - 1 following pages of the
+ * process whose contents are in the slots after PAGE's, as
+ * evict_cluster() leaves pages that were swapped out together.
+ * That turns the faults of a process walking forward through
+ * memory it had swapped out into one for every few pages.
+ * Read-ahead stops at the first page there is no free frame for.
+ * The extra frames join the frame table behind the hand like any
+ * other, so the clock looks at them last, but their accessed bits
+ * are clear: if they are still unused when the hand gets there,
+ * they go without a second chance.
+ */
+static void swap_in_around (struct page *page) {
+  struct hash *pages = &thread_current()->sup_page_table;
+  struct page *ahead[SWAP_READAHEAD];
+  struct frame *frames[SWAP_READAHEAD];
+  size_t n = 1, i;
+
+  ahead[0] = page;
+  frames[0] = page->frame;
+  while (n < SWAP_READAHEAD) {
+    struct page *next = page_lookup(pages, page->v_addr + n * PGSIZE);
+    if (next == NULL || next->frame != NULL
+        || next->swap_slot != page->swap_slot + (swap_slot_t) n)
+      break;
+    struct frame *frame = frame_allocate_free(next); /* Don't evict for a guess. */
+    if (frame == NULL) break;
+    lock_acquire(&frame_lock);
+    frame->pinned = true;
+    lock_release(&frame_lock);
+    ahead[n] = next;
+    frames[n++] = frame;
+  }
+
+  /* Consecutive slots, so the device queue merges the reads. */
+  for (i = 0; i < n; i++)
+    swap_read(ahead[i]->swap_slot, frames[i]->p_addr, &frames[i]->swap_io);
+  for (i = 0; i < n; i++)
+    block_wait(&frames[i]->swap_io);
+
+  swap_free(page->swap_slot);
+  page->swap_slot = -1;
+  for (i = 1; i < n; i++) {
+    struct page *next = ahead[i];
+    if (!install_page(next->v_addr, frames[i]->p_addr, next->writable)) {
+      frame_deallocate(frames[i]);
+      continue;
+    }
+    lock_acquire(&frame_lock);
+    next->frame = frames[i];
+    frames[i]->pinned = false;
+    lock_release(&frame_lock);
+    swap_free(next->swap_slot);
+    next->swap_slot = -1;
+  }
+}
+
 /*
  * Loads content of the virtual page in memory.
  * Exits current process if loading fails.
@@ -115,6 +184,22 @@ install_page (void *upage, void *kpage, bool writable)
 bool page_load (struct page *sup_page) {
   ASSERT(sup_page->frame == NULL);
 
+  /* Map a copy of the page another process already loaded. */
+  bool shareable = share_is_shareable(sup_page);
+  if (shareable) {
+    lock_acquire(&frame_lock);
+    if (share_attach(sup_page)) {
+      bool success = install_page(sup_page->v_addr, sup_page->frame->p_addr, false);
+      struct frame *frame = sup_page->frame;
+      bool last = !success && share_detach(sup_page);
+      if (last) frame->pinned = true; /* Eviction must not pick it before it is freed. */
+      lock_release(&frame_lock);
+      if (last) frame_deallocate(frame);
+      return success;
+    }
+    lock_release(&frame_lock);
+  }
+
   struct frame *frame = frame_allocate(sup_page);
   ASSERT (frame != NULL);
   sup_page->frame = frame;
@@ -124,8 +209,7 @@ bool page_load (struct page *sup_page) {
   lock_release(&frame_lock);
 
   if (sup_page->swap_slot != -1) {
-    swap_in(sup_page->swap_slot, frame->p_addr);
-    sup_page->swap_slot = -1;
+    swap_in_around(sup_page);
   } else if (sup_page->file_info != NULL) { /* File page. */
     file_seek(sup_page->file_info->file, sup_page->file_info->offset);
     off_t read_size = file_read(sup_page->file_info->file, frame->p_addr, sup_page->file_info->length);
@@ -144,10 +228,202 @@ bool page_load (struct page *sup_page) {
     sup_page->frame = NULL;
     return false;
   }
+  if (shareable) {
+    lock_acquire(&frame_lock);
+    share_publish(sup_page, frame);
+    lock_release(&frame_lock);
+  }
   sup_page->frame->pinned = false;
   return true;
 }
 
+/* Maps PAGE's frame again, writable or not.  PAGE must be mapped
+   already, so this can't run out of memory. */
+static void remap (struct page *page, bool writable) {
+  pagedir_clear_page(page->pagedir, page->v_addr);
+  bool success = pagedir_set_page(page->pagedir, page->v_addr, page->frame->p_addr, writable);
+  ASSERT(success);
+}
+
+/* Allocates a frame for PAGE and copies FRAME, which the caller
+   must keep pinned, into it.  The copy stays pinned until the
+   caller clears its PINNED flag.  Returns NULL if memory is
+   short. */
+static struct frame *copy_frame (struct page *page, const struct frame *frame) {
+  struct frame *copy = frame_allocate(page);
+  if (copy == NULL) return NULL;
+  lock_acquire(&frame_lock);
+  copy->pinned = true;
+  lock_release(&frame_lock);
+  memcpy(copy->p_addr, frame->p_addr, PGSIZE);
+  return copy;
+}
+
+/*
+ * Handles a write to writable PAGE of the current process that
+ * faulted because its frame is shared copy-on-write: gives PAGE
+ * its own copy of the frame, or just the frame itself once no
+ * other process maps it.
+ */
+bool page_unshare (struct page *page) {
+  ASSERT(page->writable);
+
+  lock_acquire(&frame_lock);
+  struct frame *frame = page->frame;
+  if (frame == NULL) { /* Evicted meanwhile; the retried write loads a private copy. */
+    lock_release(&frame_lock);
+    return true;
+  }
+  if (frame->share == NULL || share_is_single(frame)) { /* Last one, keep it. */
+    if (frame->share != NULL) share_detach(page);
+    page->frame = frame;
+    frame->u_page = page;
+    remap(page, true);
+    lock_release(&frame_lock);
+    return true;
+  }
+  /* Others map it too.  Copy it, pinned so that it stays put. */
+  frame->pin_cnt++;
+  lock_release(&frame_lock);
+
+  struct frame *copy = copy_frame(page, frame);
+
+  lock_acquire(&frame_lock);
+  frame->pin_cnt--;
+  if (copy == NULL) {
+    lock_release(&frame_lock);
+    return false;
+  }
+  bool last = share_detach(page); /* The others may have exited meanwhile. */
+  page->frame = copy;
+  page->dirtied = true;
+  remap(page, true);
+  copy->pinned = false;
+  if (last) frame->pinned = true; /* Eviction must not pick it before it is freed. */
+  lock_release(&frame_lock);
+  if (last) frame_deallocate(frame);
+  return true;
+}
+
+/*
+ * Loads the page of the current process that contains V_ADDR,
+ * if needed, and pins its frame so it can't be evicted until
+ * page_unpin() is called. Pins nest.
+ * If WRITE, the kernel is going to write the page through its
+ * frame, which the page table never sees, so the page is marked
+ * dirty here.
+ * Returns NULL if V_ADDR isn't mapped, WRITE is true and the
+ * page is read-only, or loading fails.
+ */
+struct page *page_pin (void *v_addr, bool write) {
+  struct page *page = page_lookup(&thread_current()->sup_page_table, pg_round_down(v_addr));
+  if (page == NULL || (write && !page->writable)) return NULL;
+
+  while (true) {
+    lock_acquire(&frame_lock);
+    if (page->frame != NULL && page->writable && share_is_copy_on_write(page->frame)) {
+      /* The kernel may write it through the frame. */
+      lock_release(&frame_lock);
+      if (!page_unshare(page)) return NULL;
+      continue;
+    }
+    if (page->frame != NULL) {
+      page->frame->pin_cnt++;
+      if (write) {
+        page->dirtied = true;
+        pagedir_set_dirty(page->pagedir, page->v_addr, true); /* For mapped files. */
+      }
+      lock_release(&frame_lock);
+      return page;
+    }
+    lock_release(&frame_lock);
+    if (!page_load(page)) return NULL;
+  }
+}
+
+/* Releases a pin taken by page_pin(). */
+void page_unpin (struct page *page) {
+  lock_acquire(&frame_lock);
+  ASSERT (page->frame != NULL && page->frame->pin_cnt > 0);
+  page->frame->pin_cnt--;
+  lock_release(&frame_lock);
+}
+
+/* Writes PAGE, a page of a memory-mapped file, back to the file
+   if it is dirty, and marks it clean.  PAGE's process must not be
+   running. */
+void page_write_back (struct page *page) {
+  lock_acquire(&frame_lock);
+  struct frame *frame = page->frame;
+  if (frame != NULL) frame->pin_cnt++;
+  lock_release(&frame_lock);
+  if (frame == NULL) return;
+
+  page_unmap(page);
+  pagedir_set_dirty(page->pagedir, page->v_addr, false);
+  page_unpin(page);
+}
+
+/*
+ * Copies the pages of PARENT that aren't memory-mapped into the
+ * supplemental page table of the current process, which fork()
+ * is creating from PARENT.  No page data is copied: resident
+ * pages are shared copy-on-write, swapped-out pages share their
+ * swap slot, and the rest load on demand as in PARENT.  Only
+ * frames pinned by asynchronous I/O, which may be written behind
+ * the page table's back, are copied right away.
+ * PARENT must be blocked, and the current process must already
+ * have its executable open.  Returns false if memory is short.
+ */
+bool page_duplicate (struct thread *parent) {
+  struct thread *t = thread_current();
+  struct hash_iterator i;
+
+  hash_first(&i, &parent->sup_page_table);
+  while (hash_next(&i)) {
+    struct page *p = hash_entry(hash_cur(&i), struct page, elem);
+    struct file_info *file_info = NULL;
+    if (p->file_info != NULL) {
+      if (p->file_info->mapped) continue; /* Done by mmap_duplicate(). */
+      ASSERT(p->file_info->file == parent->exec_file);
+      file_info = malloc(sizeof *file_info);
+      if (file_info == NULL) return false;
+      *file_info = *p->file_info;
+      file_info->file = t->exec_file;
+    }
+    struct page *c = page_allocate(p->v_addr, p->writable, file_info);
+    c->dirtied = p->dirtied;
+    if (share_is_shareable(p)) continue; /* Attaches on its first fault. */
+
+    lock_acquire(&frame_lock);
+    struct frame *frame = p->frame;
+    if (frame == NULL) {
+      if (p->swap_slot != -1) {
+        c->swap_slot = p->swap_slot;
+        swap_dup(c->swap_slot);
+      }
+    } else if (!frame->pinned && frame->pin_cnt == 0) {
+      bool success = share_copy_on_write(p, c);
+      lock_release(&frame_lock);
+      if (!success) return false;
+      continue;
+    } else {
+      frame->pin_cnt++;
+      lock_release(&frame_lock);
+      struct frame *copy = copy_frame(c, frame);
+      page_unpin(p);
+      if (copy == NULL) return false;
+      c->frame = copy;
+      c->dirtied = true;
+      if (!pagedir_set_page(c->pagedir, c->v_addr, copy->p_addr, c->writable)) return false;
+      lock_acquire(&frame_lock);
+      copy->pinned = false;
+    }
+    lock_release(&frame_lock);
+  }
+  return true;
+}
+
 void page_suplemental_table_dest (struct hash_elem *elem, void *aux UNUSED) {
   struct page *p = hash_entry (elem, struct page, elem);
   page_deallocate(p);
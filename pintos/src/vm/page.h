@@ -23,6 +23,8 @@ struct page {
     bool writable;
     struct file_info *file_info;
     swap_slot_t swap_slot;
+    bool dirtied;           /* Modified since loaded from file or zeroed? Then only swap can restore it. */
+    struct list_elem share_elem;  /* Element in its shared frame's list, if shared. */
 
     struct hash_elem elem;
 };
@@ -35,6 +37,11 @@ bool page_less (const struct hash_elem*, const struct hash_elem*, void* UNUSED);
 struct page *page_lookup (struct hash*, void *);
 void page_unmap(struct page*);
 bool page_load (struct page*);
+bool page_unshare (struct page*);
+struct page *page_pin (void*, bool);
+void page_unpin (struct page*);
+void page_write_back (struct page*);
+bool page_duplicate (struct thread*);
 void page_suplemental_table_dest (struct hash_elem*, void*);
 
 
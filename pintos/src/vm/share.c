@@ -0,0 +1,217 @@
+#include "vm/share.h"
+#include <hash.h>
+#include <list.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "userprog/pagedir.h"
+
+/* A page shared by all the processes that map it. */
+struct share {
+  struct inode *inode;    /* Executable the page comes from, or null if copy-on-write. */
+  off_t offset;           /* Offset of the page in INODE. */
+  off_t length;           /* Bytes read from INODE; the rest of the page is zeros. */
+  struct frame *frame;    /* Frame holding the page. */
+  struct list pages;      /* Supplemental pages mapping FRAME. */
+
+  struct hash_elem elem;
+};
+
+/* Shared pages, keyed by (inode, offset, length). */
+static struct hash share_table;
+
+static unsigned share_hash(const struct hash_elem*, void*);
+static bool share_less(const struct hash_elem*, const struct hash_elem*, void*);
+
+void share_init() {
+  hash_init(&share_table, share_hash, share_less, NULL);
+}
+
+/* Returns true if PAGE is a read-only page of an executable. */
+bool share_is_shareable(const struct page *page) {
+  return (!page->writable && page->file_info != NULL
+          && !page->file_info->mapped);
+}
+
+/* Returns the shared page that PAGE's contents would be, if any. */
+static struct share* share_lookup(const struct page *page) {
+  struct share key;
+  key.inode = file_get_inode(page->file_info->file);
+  key.offset = page->file_info->offset;
+  key.length = page->file_info->length;
+  struct hash_elem *e = hash_find(&share_table, &key.elem);
+  return e != NULL ? hash_entry(e, struct share, elem) : NULL;
+}
+
+/* If another process has PAGE's contents in a shared frame, makes
+   PAGE use that frame and returns true.  The caller must still
+   map it.  Otherwise returns false. */
+bool share_attach(struct page *page) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  ASSERT(share_is_shareable(page) && page->frame == NULL);
+
+  struct share *s = share_lookup(page);
+  if (s == NULL) return false;
+  list_push_back(&s->pages, &page->share_elem);
+  page->frame = s->frame;
+  return true;
+}
+
+/* Publishes FRAME, just loaded with PAGE's contents, so that other
+   processes can attach to it.  Returns false, leaving FRAME
+   private to PAGE, if the page is already shared or memory is
+   short. */
+bool share_publish(struct page *page, struct frame *frame) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  ASSERT(share_is_shareable(page) && page->frame == frame);
+
+  if (share_lookup(page) != NULL) return false;
+  struct share *s = malloc(sizeof *s);
+  if (s == NULL) return false;
+  s->inode = file_get_inode(page->file_info->file);
+  s->offset = page->file_info->offset;
+  s->length = page->file_info->length;
+  s->frame = frame;
+  list_init(&s->pages);
+  list_push_back(&s->pages, &page->share_elem);
+  hash_insert(&share_table, &s->elem);
+  frame->share = s;
+  return true;
+}
+
+/* Shares PAGE's resident frame with COPY, PAGE's counterpart in
+   a process that fork() is creating, until one of them writes to
+   it.  Maps the frame read-only in both processes.  Returns false
+   if memory is short, leaving COPY without a frame. */
+bool share_copy_on_write(struct page *page, struct page *copy) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  ASSERT(!share_is_shareable(page) && page->frame != NULL && copy->frame == NULL);
+
+  struct frame *frame = page->frame;
+  struct share *s = frame->share;
+  if (s == NULL) {
+    s = malloc(sizeof *s);
+    if (s == NULL) return false;
+    s->inode = NULL;
+    s->offset = 0;
+    s->length = 0;
+    s->frame = frame;
+    list_init(&s->pages);
+    list_push_back(&s->pages, &page->share_elem);
+    frame->share = s;
+
+    /* Write-protect PAGE.  Its dirty bit goes with the old
+       mapping, so remember it. */
+    bool accessed = pagedir_is_accessed(page->pagedir, page->v_addr);
+    page->dirtied |= pagedir_is_dirty(page->pagedir, page->v_addr);
+    pagedir_clear_page(page->pagedir, page->v_addr);
+    pagedir_set_page(page->pagedir, page->v_addr, frame->p_addr, false);
+    pagedir_set_accessed(page->pagedir, page->v_addr, accessed);
+  }
+  ASSERT(s->inode == NULL);
+
+  if (!pagedir_set_page(copy->pagedir, copy->v_addr, frame->p_addr, false)) return false;
+  list_push_back(&s->pages, &copy->share_elem);
+  copy->frame = frame;
+  copy->dirtied = page->dirtied;
+  return true;
+}
+
+/* Returns true if FRAME is shared copy-on-write. */
+bool share_is_copy_on_write(const struct frame *frame) {
+  return frame->share != NULL && frame->share->inode == NULL;
+}
+
+/* Returns true if copy-on-write FRAME holds data that only swap
+   can restore once it is evicted. */
+bool share_is_dirty(const struct frame *frame) {
+  struct list_elem *e;
+
+  ASSERT(share_is_copy_on_write(frame));
+  for (e = list_begin(&frame->share->pages); e != list_end(&frame->share->pages); e = list_next(e))
+    if (list_entry(e, struct page, share_elem)->dirtied) return true;
+  return false;
+}
+
+/* Returns true if just one page maps shared FRAME. */
+bool share_is_single(const struct frame *frame) {
+  struct list *pages = &frame->share->pages;
+  return list_begin(pages) == list_rbegin(pages);
+}
+
+/* Removes PAGE from its shared frame.  Returns true if it was the
+   last mapping, in which case the frame is no longer shared and
+   the caller must free it. */
+bool share_detach(struct page *page) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  struct share *s = page->frame->share;
+  ASSERT(s != NULL);
+
+  list_remove(&page->share_elem);
+  page->frame = NULL;
+  if (!list_empty(&s->pages)) return false;
+  if (s->inode != NULL) hash_delete(&share_table, &s->elem);
+  s->frame->share = NULL;
+  free(s);
+  return true;
+}
+
+/* Unmaps shared FRAME from every process, which will reload the
+   page on its next fault, and stops sharing it.  SLOT, if not -1,
+   is where FRAME's contents are being swapped out to, and every
+   page gets a reference to it. */
+void share_evict(struct frame *frame, swap_slot_t slot) {
+  ASSERT(lock_held_by_current_thread(&frame_lock));
+  struct share *s = frame->share;
+  ASSERT(s != NULL);
+
+  bool first = true;
+  while (!list_empty(&s->pages)) {
+    struct page *page = list_entry(list_pop_front(&s->pages), struct page, share_elem);
+    page->frame = NULL;
+    pagedir_clear_page(page->pagedir, page->v_addr);
+    if (slot != -1) {
+      if (!first) swap_dup(slot);
+      page->swap_slot = slot;
+      page->dirtied = true;
+      first = false;
+    }
+  }
+  if (s->inode != NULL) hash_delete(&share_table, &s->elem);
+  frame->share = NULL;
+  free(s);
+}
+
+/* Returns true if any process accessed shared FRAME, clearing
+   the accessed bits if CLEAR is true. */
+bool share_accessed(struct frame *frame, bool clear) {
+  struct list_elem *e;
+  bool accessed = false;
+
+  for (e = list_begin(&frame->share->pages); e != list_end(&frame->share->pages); e = list_next(e)) {
+    struct page *page = list_entry(e, struct page, share_elem);
+    if (pagedir_is_accessed(page->pagedir, page->v_addr)) {
+      accessed = true;
+      if (clear) pagedir_set_accessed(page->pagedir, page->v_addr, false);
+    }
+  }
+  return accessed;
+}
+
+/* Returns a hash value for shared page S_. */
+static unsigned share_hash(const struct hash_elem *s_, void *aux UNUSED) {
+  const struct share *s = hash_entry(s_, struct share, elem);
+  return (hash_bytes(&s->inode, sizeof s->inode) ^ hash_int(s->offset)
+          ^ hash_int(s->length));
+}
+
+/* Returns true if shared page A precedes shared page B. */
+static bool share_less(const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED) {
+  const struct share *a = hash_entry(a_, struct share, elem);
+  const struct share *b = hash_entry(b_, struct share, elem);
+  if (a->inode != b->inode) return a->inode < b->inode;
+  if (a->offset != b->offset) return a->offset < b->offset;
+  return a->length < b->length;
+}
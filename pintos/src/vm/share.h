@@ -0,0 +1,43 @@
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+#include <stdbool.h>
+#include "vm/swap.h"
+
+/* Shared read-only pages.
+
+   A read-only page loaded from an executable, such as a code
+   page, is the same in every process running that executable.
+   The first process to fault on it publishes its frame under the
+   page's (inode, offset, length), and later faults on the same
+   page map that frame instead of loading their own copy.  The
+   length matters because two segments can end partway through
+   the same page, zeroing different amounts of it.  The frame stays
+   until its last mapping goes away or it is evicted, which
+   unmaps it from every process.
+
+   fork() shares a process's other resident pages the same way,
+   copy-on-write: the frame is mapped read-only into both
+   processes, and the first write fault copies it for the
+   faulting process (see page_unshare()).  Copy-on-write frames
+   have no key, so nothing can attach to them later, and evicting
+   one writes it to swap once for all of its pages.
+
+   All of these functions must be called with FRAME_LOCK held. */
+
+struct page;
+struct frame;
+
+void share_init(void);
+bool share_is_shareable(const struct page*);
+bool share_attach(struct page*);
+bool share_publish(struct page*, struct frame*);
+bool share_copy_on_write(struct page*, struct page*);
+bool share_is_copy_on_write(const struct frame*);
+bool share_is_dirty(const struct frame*);
+bool share_is_single(const struct frame*);
+bool share_detach(struct page*);
+void share_evict(struct frame*, swap_slot_t);
+bool share_accessed(struct frame*, bool clear);
+
+#endif
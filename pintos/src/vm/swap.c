@@ -3,13 +3,20 @@
 #include "devices/block.h"
 #include "threads/vaddr.h"
 #include "threads/synch.h"
+#include "threads/malloc.h"
 
 
 struct block* swap_block_device;
 struct bitmap* swap_slots;
-swap_slot_t next_free_slot;
+swap_slot_t next_free_slot;     /* Where swap_alloc() looks first. */
 size_t bmap_size;
 
+/* Number of pages whose contents are in each slot.  A slot is
+   shared after fork() copies a swapped-out page, or when a
+   copy-on-write frame is evicted. */
+static uint16_t *swap_refs;
+static struct lock swap_lock;
+
 #define BLOCKS_IN_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
 
 
@@ -17,35 +24,81 @@ void swap_init(void) {
   swap_block_device = block_get_role(BLOCK_SWAP);
   bmap_size = block_size(swap_block_device) / BLOCKS_IN_PAGE;
   swap_slots = bitmap_create(bmap_size);
+  swap_refs = calloc(bmap_size, sizeof *swap_refs);
+  if (swap_slots == NULL || swap_refs == NULL) PANIC("swap_init: Kernel out of memory!");
+  lock_init(&swap_lock);
 }
 
-swap_slot_t swap_out(void *p_addr) {
-  swap_slot_t slot = bitmap_scan_and_flip (swap_slots, 0, 1, false);
-  if ((size_t)slot == BITMAP_ERROR) PANIC("Kernel Bug: Swap Full");
-  uint8_t *block_chunk = p_addr;
-
-  /* Write data to swap */
-  block_sector_t block_idx = slot * BLOCKS_IN_PAGE;
-  block_sector_t end_block_idx = block_idx + BLOCKS_IN_PAGE;
-  for(; block_idx < end_block_idx; block_idx++) {
-    block_write(swap_block_device, block_idx, block_chunk);
-    block_chunk += BLOCK_SECTOR_SIZE;
+/* Starts writing the page at P_ADDR to a free swap slot, which it
+   returns, without waiting for the write.  The page must not
+   change until block_wait(REQ) returns.  Swapping the slot back
+   in before that is fine: the device queue keeps the read behind
+   the write. */
+swap_slot_t swap_out_async(void *p_addr, struct block_request *req) {
+  size_t cnt = 1;
+  swap_slot_t slot = swap_alloc(&cnt);
+  swap_write(slot, p_addr, req);
+  return slot;
+}
+
+/* Allocates a run of up to *CNT consecutive free slots, with one
+   reference each, and returns the first.  Sets *CNT to the
+   number allocated, which is less only if no run that long is
+   free.  Runs are taken in order from where the last one ended,
+   so pages swapped out one after another also end up next to
+   each other. */
+swap_slot_t swap_alloc(size_t *cnt) {
+  size_t want = *cnt;
+  size_t slot, i;
+
+  ASSERT(want > 0);
+  lock_acquire(&swap_lock);
+  while (true) {
+    slot = bitmap_scan_and_flip (swap_slots, next_free_slot, want, false);
+    if (slot == BITMAP_ERROR && next_free_slot != 0)
+      slot = bitmap_scan_and_flip (swap_slots, 0, want, false);
+    if (slot != BITMAP_ERROR || want == 1) break;
+    want /= 2;
   }
+  if (slot == BITMAP_ERROR) PANIC("Kernel Bug: Swap Full");
+  for (i = 0; i < want; i++) swap_refs[slot + i] = 1;
+  next_free_slot = slot + want < bmap_size ? slot + want : 0;
+  lock_release(&swap_lock);
 
+  *cnt = want;
   return slot;
 }
 
-void swap_in(swap_slot_t slot, void *p_addr) {
-  uint8_t *block_chunk = p_addr;
+/* Starts writing the page at P_ADDR to allocated SLOT, as
+   swap_out_async() does. */
+void swap_write(swap_slot_t slot, void *p_addr, struct block_request *req) {
+  block_request_init(req, true, slot * BLOCKS_IN_PAGE, BLOCKS_IN_PAGE, p_addr, NULL, NULL);
+  block_submit(swap_block_device, req);
+}
 
-  /* Write data to page */
-  block_sector_t block_idx = slot * BLOCKS_IN_PAGE;
-  block_sector_t end_block_idx = block_idx + BLOCKS_IN_PAGE;
-  for(; block_idx < end_block_idx; block_idx++) {
-    block_read(swap_block_device, block_idx, block_chunk);
-    block_chunk += BLOCK_SECTOR_SIZE;
-  }
+/* Starts reading SLOT into the page at P_ADDR.  Requests for
+   consecutive slots are merged into one transfer.  After
+   block_wait(REQ), the caller must drop its reference with
+   swap_free(). */
+void swap_read(swap_slot_t slot, void *p_addr, struct block_request *req) {
+  block_request_init(req, false, slot * BLOCKS_IN_PAGE, BLOCKS_IN_PAGE, p_addr, NULL, NULL);
+  block_submit(swap_block_device, req);
+}
+
+/* Adds a reference to SLOT, for another page with the same
+   contents. */
+void swap_dup(swap_slot_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(swap_refs[slot] > 0 && swap_refs[slot] < UINT16_MAX);
+  swap_refs[slot]++;
+  lock_release(&swap_lock);
+}
 
-  bitmap_flip(swap_slots, slot);
+/* Drops a reference to SLOT, freeing it after the last one. */
+void swap_free(swap_slot_t slot) {
+  lock_acquire(&swap_lock);
+  ASSERT(swap_refs[slot] > 0);
+  if (--swap_refs[slot] == 0) bitmap_reset(swap_slots, slot);
+  lock_release(&swap_lock);
 }
 
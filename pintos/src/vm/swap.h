@@ -1,11 +1,17 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+#include "devices/block.h"
+
 /* Index of a slot in swap. */
 typedef long swap_slot_t;
 
 void swap_init(void);
-swap_slot_t swap_out(void*);
-void swap_in(swap_slot_t, void*);
+swap_slot_t swap_out_async(void*, struct block_request*);
+swap_slot_t swap_alloc(size_t *cnt);
+void swap_write(swap_slot_t, void*, struct block_request*);
+void swap_read(swap_slot_t, void*, struct block_request*);
+void swap_dup(swap_slot_t);
+void swap_free(swap_slot_t);
 
 #endif